@@ -0,0 +1,604 @@
+#include "Book.hpp"
+
+#include <sstream>
+
+#include "Cache.hpp"
+#include "CompiledBook.hpp"
+#include "ImageCache.hpp"
+#include "JsonScanner.hpp"
+#include "MappedFile.hpp"
+#include "WorkerPool.hpp"
+
+namespace {
+	// Top-level fields of a book's JSON and the
+	// source text of each page
+	struct BookSource {
+		std::string title;
+		std::string front;
+		std::string back;
+		bool test = false;
+		std::map<std::size_t, std::string_view> pages;
+	};
+
+	BookSource ScanSource(const MappedFile &file) {
+		BookSource source;
+		JsonScanner scanner(reinterpret_cast<const char *>(file.Data()), file.Size());
+
+		std::string key;
+		scanner.BeginObject();
+		while (scanner.NextKey(key)) {
+			if (key == "title") {
+				source.title = scanner.ReadOptionalString();
+			} else if (key == "front") {
+				source.front = scanner.ReadOptionalString();
+			} else if (key == "back") {
+				source.back = scanner.ReadOptionalString();
+			} else if (key == "test") {
+				source.test = scanner.ReadOptionalBool(false);
+			} else if (key == "pages") {
+				if (scanner.Peek() == '[') {
+					scanner.BeginArray();
+					for (std::size_t number = 0; scanner.NextElement(); ++number)
+						source.pages[number] = scanner.ReadRaw();
+				} else {
+					std::string number;
+					scanner.BeginObject();
+					while (scanner.NextKey(number))
+						source.pages[std::stoull(number)] = scanner.ReadRaw();
+				}
+			} else {
+				scanner.SkipValue();
+			}
+		}
+
+		return source;
+	}
+
+	// FNV-1a
+	uint64_t HashSource(std::string_view source) {
+		uint64_t hash = 14695981039346656037ull;
+		for (auto c : source) {
+			hash ^= static_cast<uint8_t>(c);
+			hash *= 1099511628211ull;
+		}
+
+		return hash;
+	}
+}
+
+bool Book::Page::Image::Decode(uint64_t *hash) {
+	ReleasePixels();
+
+	MappedFile source(FileRepository::registry->GetResourceDirectory() / relativePath);
+	if (!source.IsOpen()) return false;
+
+	if (hash)
+		*hash = ImageCache::Hash(source.Data(), source.Size());
+
+	auto result = fpng::fpng_decode_memory(
+		source.Data(),
+		static_cast<uint32_t>(source.Size()),
+		data,
+		width,
+		height,
+		channels,
+		4
+	);
+	UpdateRatio();
+
+	return result == fpng::FPNG_DECODE_SUCCESS;
+}
+
+bool Book::Page::Image::Prepare(bool chrome) {
+	ImageCache::Options options;
+	options.kind = chrome ? "Chrome" : "Page";
+	if (!chrome) {
+		std::tie(options.maxWidth, options.maxHeight) = ImagePipeline::GetDisplayBound();
+		options.compress = ImagePipeline::IsCompressionEnabled();
+	}
+
+	auto stamp = Cache::GetStamp(FileRepository::registry->GetResourceDirectory() / relativePath);
+	if (stamp && ImageCache::Load(*this, options, *stamp))
+		return true;
+
+	uint64_t hash = 0;
+	if (!Decode(&hash)) return false;
+
+	auto sourceWidth = width, sourceHeight = height;
+	if (width > options.maxWidth || height > options.maxHeight) {
+		ImagePipeline::Fit(data, width, height, options.maxWidth, options.maxHeight);
+		UpdateRatio();
+		boundWidth = options.maxWidth;
+		boundHeight = options.maxHeight;
+	} else {
+		boundWidth = boundHeight = 0;
+	}
+
+	if (options.compress)
+		Compress();
+
+	if (stamp)
+		ImageCache::Store(*this, options, *stamp, hash, sourceWidth, sourceHeight);
+
+	return true;
+}
+
+std::filesystem::path Book::GetCompiledPath(const std::filesystem::path &path) {
+	auto compiledPath = Cache::GetDirectory("Books") / path.filename();
+	compiledPath.replace_extension(".chbook");
+
+	return compiledPath;
+}
+
+void Book::DecodeImages() {
+	std::vector<Page::Image *> images;
+
+	if (back)
+		images.emplace_back(back.get());
+
+	if (loadMode == LoadMode::Hard) {
+		for (auto &page : pages) {
+			if (page.image)
+				images.emplace_back(page.image.get());
+		}
+	}
+
+	WorkerPool::Shared().ParallelFor(images.size(), [&](std::size_t i) {
+		images[i]->Prepare();
+	});
+}
+
+std::set<std::size_t> Book::Reload() {
+	std::set<std::size_t> changed;
+	auto data = Compile(changed);
+
+	auto previousPages = std::move(pages);
+	auto previousBack = std::move(back);
+	try {
+		Load(CompiledBook::Reader(data.data(), data.size()));
+	}
+	catch (std::exception &e) {
+		pages = std::move(previousPages);
+		back = std::move(previousBack);
+		throw;
+	}
+
+	std::map<std::size_t, Page *> previousByNumber;
+	for (auto &page : previousPages)
+		previousByNumber.emplace(page.number, &page);
+
+	// An unchanged image path keeps its decoded data
+	// and texture
+	const auto keep = [&](std::unique_ptr<Page::Image> &image, std::unique_ptr<Page::Image> &previous) {
+		if (image && previous && image->relativePath == previous->relativePath) {
+			image = std::move(previous);
+			return true;
+		}
+
+		return false;
+	};
+
+	std::vector<Page::Image *> images;
+	for (auto &page : pages) {
+		auto previous = previousByNumber.find(page.number);
+		if (previous != previousByNumber.end() && keep(page.image, previous->second->image)) continue;
+
+		if (page.image && loadMode == LoadMode::Hard)
+			images.emplace_back(page.image.get());
+	}
+
+	if (back && !keep(back, previousBack))
+		images.emplace_back(back.get());
+
+	for (auto &page : previousPages) {
+		if (page.image)
+			retiredImages.emplace_back(std::move(page.image));
+	}
+	if (previousBack)
+		retiredImages.emplace_back(std::move(previousBack));
+
+	WorkerPool::Shared().ParallelFor(images.size(), [&](std::size_t i) {
+		images[i]->Prepare();
+	});
+
+	valid = true;
+
+	return changed;
+}
+
+void Book::ReleaseRetiredImages(const std::function<bool(const Page::Image &)> &busy) {
+	retiredImages.erase(
+		std::remove_if(retiredImages.begin(), retiredImages.end(), [&](const auto &image) { return !busy(*image); }),
+		retiredImages.end()
+	);
+}
+
+bool Book::LoadCompiled() {
+	auto stamp = Cache::GetStamp(path);
+	if (!stamp) return false;
+
+	MappedFile file(GetCompiledPath(path));
+	if (!file.IsOpen()) return false;
+
+	try {
+		CompiledBook::Reader reader(file.Data(), file.Size());
+		const auto &header = reader.GetHeader();
+
+		// Stale, recompile from JSON
+		if (header.sourceSize != stamp->size || header.sourceTime != stamp->time)
+			return false;
+
+		Load(reader);
+	}
+	catch (std::exception &e) {
+		logger.WriteDebug("Ignoring compiled book for ", path.string(), ": ", e.what());
+		return false;
+	}
+
+	return true;
+}
+
+void Book::Load(const CompiledBook::Reader &reader) {
+	const auto &header = reader.GetHeader();
+
+	// Copy every string into the arena in one go, and
+	// rebase views of the compiled strings onto it
+	const auto strings = reader.GetString({ 0, static_cast<uint32_t>(header.stringsSize) });
+	std::vector<char> loadedText(strings.begin(), strings.end());
+
+	const auto view = [&](const CompiledBook::StringRef &ref) {
+		auto string = reader.GetString(ref);
+		return std::string_view(loadedText.data() + (string.data() - strings.data()), string.size());
+	};
+
+	std::vector<std::string_view> loadedParagraphs;
+	std::vector<std::string_view> loadedSounds;
+	std::vector<Markdown::Run> loadedRuns;
+	std::vector<Markdown::RunRange> loadedParagraphRuns;
+
+	if (loadMode != LoadMode::Soft) {
+		loadedRuns.reserve(reader.GetRuns().size());
+		for (const auto &run : reader.GetRuns())
+			loadedRuns.push_back({ run.style, run.begin, run.end });
+
+		// Runs are complete, so ranges into them stay valid
+		loadedParagraphs.reserve(reader.GetParagraphs().size());
+		loadedParagraphRuns.reserve(reader.GetParagraphs().size());
+		for (const auto &paragraph : reader.GetParagraphs()) {
+			auto paragraphRuns = CompiledBook::Table<Markdown::Run>(loadedRuns.data(), loadedRuns.size()).Slice(paragraph.runs);
+
+			loadedParagraphs.emplace_back(view(paragraph.text));
+			loadedParagraphRuns.emplace_back(paragraphRuns.begin(), paragraphRuns.end());
+		}
+
+		loadedSounds.reserve(reader.GetSounds().size());
+		for (const auto &sound : reader.GetSounds())
+			loadedSounds.emplace_back(view(sound));
+	}
+
+	std::vector<Page> loadedPages;
+	std::vector<std::size_t> loadedNumbers;
+	loadedPages.reserve(reader.GetPages().size());
+	loadedNumbers.reserve(reader.GetPages().size());
+	for (const auto &record : reader.GetPages()) {
+		if (!loadedPages.empty() && record.number <= loadedPages.back().number)
+			throw std::runtime_error("Compiled book pages out of order");
+
+		Page page;
+
+		page.number = record.number;
+		if (record.flags & CompiledBook::PageHasEntryNumber)
+			page.entryNumber = record.entryNumber;
+		page.sourceHash = record.sourceHash;
+		page.type = static_cast<Page::Type>(record.type);
+		page.spicy = record.flags & CompiledBook::PageSpicy;
+		page.title = view(record.title);
+		page.date = view(record.date);
+		page.font = view(record.font);
+		page.titleStyle = view(record.titleStyle);
+
+		if (loadMode != LoadMode::Soft) {
+			page.paragraphs = CompiledBook::Table<std::string_view>(loadedParagraphs.data(), loadedParagraphs.size()).Slice(record.paragraphs);
+			page.paragraphRuns = CompiledBook::Table<Markdown::RunRange>(loadedParagraphRuns.data(), loadedParagraphRuns.size()).Slice(record.paragraphs);
+			page.sounds = CompiledBook::Table<std::string_view>(loadedSounds.data(), loadedSounds.size()).Slice(record.sounds);
+
+			if (record.flags & CompiledBook::PageHasImage) {
+				page.image = std::make_unique<Page::Image>();
+				page.image->relativePath = reader.GetString(record.image);
+			}
+		}
+
+		loadedNumbers.emplace_back(page.number);
+		loadedPages.emplace_back(std::move(page));
+	}
+
+	std::map<uint32_t, std::vector<std::string>> loadedStyles;
+	for (const auto &style : reader.GetStyles()) {
+		auto &tokens = loadedStyles[style.hash];
+		for (const auto &token : reader.GetTokens().Slice(style.tokens))
+			tokens.emplace_back(reader.GetString(token));
+	}
+
+	std::unique_ptr<Page::Image> loadedBack;
+	if (loadMode != LoadMode::Soft && header.back.length) {
+		loadedBack = std::make_unique<Page::Image>();
+		loadedBack->relativePath = reader.GetString(header.back);
+	}
+
+	test = header.flags & CompiledBook::HeaderTest;
+	title = reader.GetString(header.title);
+	front = reader.GetString(header.front);
+	back = std::move(loadedBack);
+
+	// Moving the vectors keeps their buffers, so
+	// every view above stays valid
+	text = std::move(loadedText);
+	paragraphs = std::move(loadedParagraphs);
+	sounds = std::move(loadedSounds);
+	runs = std::move(loadedRuns);
+	paragraphRuns = std::move(loadedParagraphRuns);
+	pages = std::move(loadedPages);
+	pageNumbers = std::move(loadedNumbers);
+	styles = std::move(loadedStyles);
+}
+
+void Book::LoadMetadata() {
+	MappedFile file(path);
+	if (!file.IsOpen())
+		throw std::runtime_error("Unable to open " + path.string());
+
+	JsonScanner scanner(reinterpret_cast<const char *>(file.Data()), file.Size());
+	CompiledBook::Writer writer;
+
+	// Pages can come in any order, so they're
+	// sorted before being written
+	std::map<std::size_t, CompiledBook::PageRecord> records;
+	const auto readPage = [&](std::size_t number) {
+		CompiledBook::PageRecord record;
+		record.number = number;
+		record.type = static_cast<uint32_t>(Page::Type::Poem);
+
+		std::string key;
+		scanner.BeginObject();
+		while (scanner.NextKey(key)) {
+			if (key == "number") {
+				if (auto entryNumber = scanner.ReadOptionalInteger()) {
+					record.entryNumber = *entryNumber;
+					record.flags |= CompiledBook::PageHasEntryNumber;
+				}
+			} else if (key == "title") {
+				record.title = writer.AddString(scanner.ReadOptionalString());
+			} else if (key == "date") {
+				record.date = writer.AddString(scanner.ReadOptionalString());
+			} else if (key == "type") {
+				if (auto typeString = scanner.ReadOptionalString(); !typeString.empty())
+					record.type = static_cast<uint32_t>(magic_enum::enum_cast<Page::Type>(typeString).value());
+			} else {
+				scanner.SkipValue();
+			}
+		}
+
+		records[number] = record;
+	};
+
+	std::string key;
+	scanner.BeginObject();
+	while (scanner.NextKey(key)) {
+		if (key == "title") {
+			writer.header.title = writer.AddString(scanner.ReadOptionalString());
+		} else if (key == "front") {
+			writer.header.front = writer.AddString(scanner.ReadOptionalString());
+		} else if (key == "test") {
+			if (scanner.ReadOptionalBool(false))
+				writer.header.flags |= CompiledBook::HeaderTest;
+		} else if (key == "pages") {
+			// Pages are keyed by number, either as
+			// object keys or by array position
+			if (scanner.Peek() == '[') {
+				scanner.BeginArray();
+				for (std::size_t number = 0; scanner.NextElement(); ++number)
+					readPage(number);
+			} else {
+				std::string number;
+				scanner.BeginObject();
+				while (scanner.NextKey(number))
+					readPage(std::stoull(number));
+			}
+		} else {
+			scanner.SkipValue();
+		}
+	}
+
+	for (const auto &[number, record] : records)
+		writer.pages.push_back(record);
+
+	auto data = writer.Finish();
+	Load(CompiledBook::Reader(data.data(), data.size()));
+}
+
+std::vector<uint8_t> Book::Compile(std::set<std::size_t> &changed) {
+	// Stamp before reading, so an edit made while we're
+	// compiling shows up as stale next time
+	auto stamp = Cache::GetStamp(path);
+
+	MappedFile file(path);
+	if (!file.IsOpen())
+		throw std::runtime_error("Unable to open " + path.string());
+
+	auto source = ScanSource(file);
+	if (source.title.empty() || source.pages.empty())
+		throw std::runtime_error("Book has no title or pages");
+
+	CompiledBook::Writer writer;
+
+	writer.header.flags = source.test ? CompiledBook::HeaderTest : 0;
+	if (stamp) {
+		writer.header.sourceSize = stamp->size;
+		writer.header.sourceTime = stamp->time;
+	}
+	writer.header.title = writer.AddString(source.title);
+	writer.header.front = writer.AddString(source.front);
+	if (!source.back.empty())
+		writer.header.back = writer.AddString(source.back);
+
+	// Copied pages already have their styles in ours
+	auto permutations = styles;
+	for (const auto &[number, text] : source.pages) {
+		auto hash = HashSource(text);
+		if (auto page = GetPage(number); page && page->sourceHash == hash) {
+			AddPage(writer, *page);
+			continue;
+		}
+
+		std::istringstream stream{ std::string(text) };
+		Node node;
+		node.ParseStream<Json>(stream);
+
+		AddPage(writer, number, hash, node, permutations);
+		changed.emplace(number);
+	}
+
+	for (const auto &page : pages) {
+		if (source.pages.find(page.number) == source.pages.end())
+			changed.emplace(page.number);
+	}
+
+	logger.WriteDebug("Styles: ");
+	for (const auto &[i, permutation] : Enumerate(permutations)) {
+		logger.WriteDebug("\t", i);
+		for (const auto &token : permutation.second) {
+			logger.WriteDebug("\t\t", token);
+		}
+	}
+
+	for (const auto &[hash, tokens] : permutations) {
+		CompiledBook::StyleRecord record;
+		record.hash = hash;
+		record.tokens = { static_cast<uint32_t>(writer.tokens.size()), static_cast<uint32_t>(tokens.size()) };
+
+		for (const auto &token : tokens)
+			writer.tokens.push_back(writer.AddString(token));
+
+		writer.styles.push_back(record);
+	}
+
+	auto data = writer.Finish();
+
+	// Save the compiled book so the next load can skip
+	// JSON and markdown parsing entirely
+	if (stamp && !Cache::WriteAtomic(GetCompiledPath(path), data.data(), data.size()))
+		logger.WriteDebug("Failed to write compiled book for ", path.string());
+
+	return data;
+}
+
+void Book::AddPage(CompiledBook::Writer &writer, const Page &page) {
+	CompiledBook::PageRecord record;
+
+	record.number = page.number;
+	record.sourceHash = page.sourceHash;
+	if (page.entryNumber) {
+		record.entryNumber = *page.entryNumber;
+		record.flags |= CompiledBook::PageHasEntryNumber;
+	}
+	if (page.spicy)
+		record.flags |= CompiledBook::PageSpicy;
+	record.type = static_cast<uint32_t>(page.type);
+	record.title = writer.AddString(page.title);
+	record.date = writer.AddString(page.date);
+	record.font = writer.AddString(page.font);
+	record.titleStyle = writer.AddString(page.titleStyle);
+
+	if (page.image) {
+		record.image = writer.AddString(page.image->relativePath);
+		record.flags |= CompiledBook::PageHasImage;
+	}
+
+	record.paragraphs = { static_cast<uint32_t>(writer.paragraphs.size()), static_cast<uint32_t>(page.paragraphs.size()) };
+	for (const auto &[p, paragraph] : Enumerate(page.paragraphs)) {
+		CompiledBook::ParagraphRecord paragraphRecord;
+		paragraphRecord.text = writer.AddString(paragraph);
+		paragraphRecord.runs.first = static_cast<uint32_t>(writer.runs.size());
+
+		for (const auto &run : page.GetRuns(p))
+			writer.runs.push_back({ run.style, run.begin, run.end });
+
+		paragraphRecord.runs.count = static_cast<uint32_t>(writer.runs.size()) - paragraphRecord.runs.first;
+		writer.paragraphs.push_back(paragraphRecord);
+	}
+
+	record.sounds = { static_cast<uint32_t>(writer.sounds.size()), static_cast<uint32_t>(page.sounds.size()) };
+	for (const auto &sound : page.sounds)
+		writer.sounds.push_back(writer.AddString(sound));
+
+	writer.pages.push_back(record);
+}
+
+void Book::AddPage(CompiledBook::Writer &writer, std::size_t number, uint64_t sourceHash, const Node &node, Markdown::Permutations &permutations) {
+	CompiledBook::PageRecord record;
+
+	record.number = number;
+	record.sourceHash = sourceHash;
+
+	std::optional<std::size_t> entryNumber;
+	node["number"].Get(entryNumber);
+	if (entryNumber) {
+		record.entryNumber = *entryNumber;
+		record.flags |= CompiledBook::PageHasEntryNumber;
+	}
+
+	bool spicy = false;
+	node["spicy"].Get(spicy);
+	if (spicy)
+		record.flags |= CompiledBook::PageSpicy;
+
+	record.type = static_cast<uint32_t>(Page::Type::Poem);
+	auto typeString = node["type"].Get<std::string>();
+	if (!typeString.empty())
+		record.type = static_cast<uint32_t>(magic_enum::enum_cast<Page::Type>(typeString).value());
+
+	std::string title, date, font, titleStyle;
+	node["title"].Get(title);
+	node["date"].Get(date);
+	node["font"].Get(font);
+	node["titleStyle"].Get(titleStyle);
+	record.title = writer.AddString(title);
+	record.date = writer.AddString(date);
+	record.font = writer.AddString(font);
+	record.titleStyle = writer.AddString(titleStyle);
+
+	if (node.HasProperty("image")) {
+		std::string image;
+		node["image"].Get(image);
+		record.image = writer.AddString(image);
+		record.flags |= CompiledBook::PageHasImage;
+	}
+
+	// Parse markdown out of paragraphs
+	std::vector<std::string> paragraphs;
+	node["paragraphs"].Get(paragraphs);
+
+	std::vector<Markdown::Run> runs;
+	record.paragraphs = { static_cast<uint32_t>(writer.paragraphs.size()), static_cast<uint32_t>(paragraphs.size()) };
+	for (const auto &paragraph : paragraphs) {
+		runs.clear();
+
+		CompiledBook::ParagraphRecord paragraphRecord;
+		paragraphRecord.text = writer.AddString(Markdown::Parse(paragraph, runs, permutations));
+		paragraphRecord.runs = { static_cast<uint32_t>(writer.runs.size()), static_cast<uint32_t>(runs.size()) };
+
+		for (const auto &run : runs)
+			writer.runs.push_back({ run.style, run.begin, run.end });
+
+		writer.paragraphs.push_back(paragraphRecord);
+	}
+
+	std::vector<std::string> sounds;
+	node["sounds"].Get(sounds);
+
+	record.sounds = { static_cast<uint32_t>(writer.sounds.size()), static_cast<uint32_t>(sounds.size()) };
+	for (const auto &sound : sounds)
+		writer.sounds.push_back(writer.AddString(sound));
+
+	writer.pages.push_back(record);
+}
\ No newline at end of file
@@ -1,6 +1,7 @@
 #pragma once
 
-#include <stack>
+#include <algorithm>
+#include <functional>
 
 #include "Filesystem/FileRepository.hpp"
 #include "Filesystem/Serial/Node.hpp"
@@ -9,13 +10,20 @@
 
 #include "third_party/fpng/fpng.h"
 
+#include "CompiledBook.hpp"
+#include "ImagePipeline.hpp"
+#include "Markdown.hpp"
+
 using namespace SnobasteCPP;
 
 class Book : public LoggableClass {
 public:
 	enum class LoadMode {
 		Soft,
-		Hard
+		Hard,
+		// Like Hard, but page images are left for the
+		// renderer to decode around the current page
+		Windowed
 	};
 
 	class Page {
@@ -35,10 +43,55 @@ public:
 			float ratio = 1.0f;
 			uint32_t channels = 4;
 
+			// Renderer texture handle, set once the image is uploaded
+			uint32_t texture = 0;
+
+			// Display bound the image was shrunk to fit, or 0 if
+			// it is at full size
+			uint32_t boundWidth = 0, boundHeight = 0;
+
+			// Set by Compress or the image cache, uploaded in
+			// place of data
+			ImagePipeline::TextureData upload;
+
 			void UpdateRatio() {
 				scaledWidth = width;
 				scaledHeight = height;
-				ratio = width / static_cast<float>(height);
+				ratio = height ? width / static_cast<float>(height) : 1.0f;
+			}
+
+			// Decodes the image at relativePath into data. Sets hash
+			// to the encoded file's hash if given.
+			bool Decode(uint64_t *hash = nullptr);
+
+			// Readies the image for upload, from the image cache when
+			// it has a match. Page images are fitted to the display
+			// bound and compressed, chrome stays full size RGBA so it
+			// can be packed into the atlas. Safe on worker threads.
+			bool Prepare(bool chrome = false);
+
+			// Transcodes data to S3TC when the renderer supports it,
+			// freeing the RGBA pixels
+			void Compress() {
+				if (data.empty() || !ImagePipeline::IsCompressionEnabled()) return;
+
+				upload = ImagePipeline::Compress(data, width, height);
+				std::vector<uint8_t>().swap(data);
+			}
+
+			// RGBA8 pixels, decoded or mapped from the cache
+			const uint8_t *GetRGBA() const {
+				if (!data.empty()) return data.data();
+				return !upload.levels.empty() && !upload.IsCompressed() ? upload.GetLevel(0) : nullptr;
+			}
+
+			bool HasPixels() const { return !data.empty() || !upload.levels.empty(); }
+			std::size_t GetPixelSize() const { return upload.levels.empty() ? data.size() : upload.Size(); }
+
+			void ReleasePixels() {
+				// See https://cplusplus.com/reference/vector/vector/clear/
+				std::vector<uint8_t>().swap(data);
+				upload = ImagePipeline::TextureData();
 			}
 
 			void Scale(float targetWidth, float targetHeight) {
@@ -55,204 +108,92 @@ public:
 			}
 		};
 
-		LoadMode loadMode = LoadMode::Hard;
+		std::size_t number = 0;
 		Type type = Type::Poem;
 		std::optional<std::size_t> entryNumber;
-		std::string title;
-		std::string date;
-		std::vector<std::string> paragraphs;
-		std::unique_ptr<Image> image;
-		std::string font;
-		std::string titleStyle;
+		std::string_view title;
+		std::string_view date;
+		std::string_view font;
+		std::string_view titleStyle;
 		OpenGLFont::Style style;
-		std::vector<std::string> sounds;
 		bool spicy = false;
+		std::unique_ptr<Image> image;
 
-		explicit Page(LoadMode loadMode = LoadMode::Hard) :
-			loadMode(loadMode) {
+		// Stripped paragraph text and sound paths, viewing
+		// the book's text arena
+		CompiledBook::Table<std::string_view> paragraphs;
+		CompiledBook::Table<std::string_view> sounds;
 
-		}
-		
-		friend Node &operator<<(Node &left, const Page &right) {
-			left["number"].Set(right.entryNumber);
-			left["title"].Set(right.title);
-			left["date"].Set(right.date);
-			left["paragraphs"].Set(right.paragraphs);
-			left["font"].Set(right.font);
-			left["titleStyle"].Set(right.titleStyle);
-			left["sounds"].Set(right.sounds);
-			left["type"].Set(magic_enum::enum_name(right.type));
-			left["spicy"].Set(right.spicy);
-
-			if (right.image)
-				left["image"].Set(right.image->relativePath);
-
-			return left;
+		Markdown::RunRange GetRuns(std::size_t paragraph) const {
+			return paragraph < paragraphRuns.size() ? paragraphRuns[paragraph] : Markdown::RunRange();
 		}
 
-		friend const Node &operator>>(const Node &left, Page &right) {
-			left["number"].Get(right.entryNumber);
-			left["title"].Get(right.title);
-			left["date"].Get(right.date);
-			left["paragraphs"].Get(right.paragraphs);
-			left["font"].Get(right.font);
-			left["titleStyle"].Get(right.titleStyle);
-			left["sounds"].Get(right.sounds);
-			left["spicy"].Get(right.spicy);
-			auto typeString = left["type"].Get<std::string>();
-			if (!typeString.empty())
-				right.type = magic_enum::enum_cast<Page::Type>(typeString).value();
-
-			if (right.loadMode == Book::LoadMode::Soft) return left;
-
-			for (auto &paragraph : right.paragraphs) {
-				paragraph = StringUtils::ReplaceAll(paragraph, "\t", "          ");
-			}
-
-			if (left.HasProperty("image")) {
-				right.image = std::make_unique<Page::Image>();
-				left["image"].Get(right.image->relativePath);
-
-				fpng::fpng_decode_file(
-					std::filesystem::absolute(FileRepository::registry->GetResourceDirectory() / right.image->relativePath).string().c_str(),
-					right.image->data,
-					right.image->width,
-					right.image->height,
-					right.image->channels,
-					4
-				);
-				right.image->UpdateRatio();
-			}
-
-			// Parse markdown out of paragraphs
-			std::tuple<uint32_t, std::size_t, std::size_t> currentSpan;
-			std::stack<std::size_t> startStack;
-			std::vector<std::string> tokenStack;
-			std::string token;
-			for (auto &[p, paragraph] : Enumerate(right.paragraphs)) {
-				std::size_t i = 0;
-				for (auto c = paragraph.begin(); c != paragraph.end();) {
-					if (*c == '[') {
-						token.clear();
-						c = paragraph.erase(c);
-						while (c != paragraph.end() && *c != ']') {
-							token += *c;
-							c = paragraph.erase(c);
-						}
-						if (c != paragraph.end() && *c == ']')
-							c = paragraph.erase(c);
-
-						if (*token.begin() == '/') {
-							if (!tokenStack.empty() && *tokenStack.rbegin() == token.substr(1)) {
-								// Calculate hash of current permutation
-								std::string permutationString;
-								for (const auto &permutation : tokenStack)
-									permutationString += permutation;
-
-								auto hash = StringUtils::fnv1a_32(permutationString);
-								right.permutations.emplace(
-									std::make_pair(
-										hash,
-										tokenStack
-									)
-								);
-								std::get<0>(currentSpan) = hash;
-								std::get<1>(currentSpan) = startStack.top();
-								startStack.pop();
-								std::get<2>(currentSpan) = i;
-								right.spans[p].emplace_back(currentSpan);
-
-								tokenStack.pop_back();
-							}
-						} else {
-							startStack.push(i);
-
-							tokenStack.emplace_back(token);
-						}
-					} else {
-						++i;
-						++c;
-					}
-				}
-			}
-
-			return left;
-		}
+	private:
+		friend class Book;
 
-		const std::map<uint32_t, std::vector<std::string>> &GetPermutations() const { return permutations; }
-		const std::map<std::size_t, std::vector<std::tuple<uint32_t, std::size_t, std::size_t>>> &GetSpans() const { return spans; }
+		// Hash of this page's JSON source
+		uint64_t sourceHash = 0;
 
-	private:
-		std::map<uint32_t, std::vector<std::string>> permutations;
-		std::map<std::size_t, std::vector<std::tuple<uint32_t, std::size_t, std::size_t>>> spans;
+		CompiledBook::Table<Markdown::RunRange> paragraphRuns;
 	};
 
 	explicit Book(const std::filesystem::path &path, LoadMode loadMode = LoadMode::Hard) :
 		loadMode(loadMode) {
 		this->path = path;
-		std::ifstream inFile(path);
-		
-		try {
-			Node node;
-			node.ParseStream<Json>(inFile);
-			node["test"].GetWithFallback(test, false);
-			node["title"].Get(title);
-			node["front"].Get(front);
-			if (loadMode == LoadMode::Hard && node.HasProperty("back")) {
-				back = std::make_unique<Page::Image>();
-				node["back"].Get(back->relativePath);
-
-				fpng::fpng_decode_file(
-					std::filesystem::absolute(FileRepository::registry->GetResourceDirectory() / back->relativePath).string().c_str(),
-					back->data,
-					back->width,
-					back->height,
-					back->channels,
-					4
-				);
-				back->UpdateRatio();
-			}
-			for (const auto &[number, pageNode] : node["pages"].Get<std::map<std::size_t, Node>>()) {
-				Page page(loadMode);
-				pageNode >> page;
-				pages.emplace(
-					std::make_pair(
-						number,
-						std::move(page)
-					)
-				);
-			}
 
-			if (title.empty() || pages.empty()) {
-				valid = false;
-				return;
+		try {
+			// Prefer the compiled book if it is up to date with
+			// its JSON source. The menu only needs metadata, so
+			// soft loads stream past everything else.
+			if (!LoadCompiled()) {
+				if (loadMode == LoadMode::Soft) {
+					LoadMetadata();
+				} else {
+					std::set<std::size_t> changed;
+					auto data = Compile(changed);
+					Load(CompiledBook::Reader(data.data(), data.size()));
+				}
 			}
 		}
 		catch (std::exception &e) {
+			logger.WriteDebug("Unable to load ", path.string(), ": ", e.what());
 			valid = false;
 			return;
 		}
 
-		if (loadMode == LoadMode::Soft) return;
-
-		// Collate all of our style permutations
-		for (const auto &page : pages) {
-			styles.insert(page.second.GetPermutations().begin(), page.second.GetPermutations().end());
+		if (title.empty() || pages.empty()) {
+			valid = false;
+			return;
 		}
 
-		logger.WriteDebug("Styles: ");
-		for (auto &[i, permutation] : Enumerate(styles)) {
-			logger.WriteDebug("\t", i);
-			for (auto &token : permutation.second) {
-				logger.WriteDebug("\t\t", token);
-			}
-		}
+		if (loadMode != LoadMode::Soft)
+			DecodeImages();
 	}
 
 	Book(Book &&right) noexcept = default;
+	Book &operator=(Book &&right) noexcept = default;
+
+	// Re-reads the JSON source after it changed on disk, only
+	// parsing pages whose source differs. Returns the numbers of
+	// pages that were added, changed or removed. Throws and leaves
+	// the book untouched if the source is malformed.
+	std::set<std::size_t> Reload();
+
+	// Frees images replaced by Reload that busy says nothing is
+	// still decoding into
+	void ReleaseRetiredImages(const std::function<bool(const Page::Image &)> &busy);
+
+	// Pages in order of their number
+	const std::vector<Page> &GetPages() const { return pages; }
+	std::vector<Page> &GetPages() { return pages; }
+
+	// Page by number, or nullptr if the book has none
+	const Page *GetPage(std::size_t number) const {
+		auto iter = std::lower_bound(pageNumbers.begin(), pageNumbers.end(), number);
+		return iter != pageNumbers.end() && *iter == number ? &pages[iter - pageNumbers.begin()] : nullptr;
+	}
+	Page *GetPage(std::size_t number) { return const_cast<Page *>(std::as_const(*this).GetPage(number)); }
 
-	const std::map<std::size_t, Page> &GetPages() const { return pages; }
-	std::map<std::size_t, Page> &GetPages() { return pages; }
 	const std::map<uint32_t, std::vector<std::string>> &GetStyles() const { return styles; }
 
 	const std::string &GetTitle() const { return title; }
@@ -260,20 +201,67 @@ public:
 	std::unique_ptr<Page::Image> &GetBack() { return back; }
 
 	const std::filesystem::path &GetPath() const { return path; }
+	LoadMode GetLoadMode() const { return loadMode; }
 
 	const bool IsValid() const { return valid; }
 	const bool IsTest() const { return test; }
 
+	static std::filesystem::path GetCompiledPath(const std::filesystem::path &path);
+
 private:
+	friend class Catalog;
+
+	// Filled in directly by the library catalog
+	Book() = default;
+
+	bool LoadCompiled();
+
+	// Reads title, front, test and each page's number, title,
+	// type and date, skipping paragraphs without parsing them
+	void LoadMetadata();
+
+	// Compiles the JSON source and saves it to the cache. Pages
+	// whose source matches a loaded page are copied instead of
+	// being parsed again. Fills changed with the numbers of pages
+	// that were added, changed or removed.
+	std::vector<uint8_t> Compile(std::set<std::size_t> &changed);
+
+	// Replaces the book's contents with a compiled book. Leaves
+	// the book untouched if it throws.
+	void Load(const CompiledBook::Reader &reader);
+
+	static void AddPage(CompiledBook::Writer &writer, const Page &page);
+	static void AddPage(CompiledBook::Writer &writer, std::size_t number, uint64_t sourceHash, const Node &node, Markdown::Permutations &permutations);
+
+	// Decodes the back cover and, unless windowed, every
+	// page image across the shared worker pool
+	void DecodeImages();
+
 	std::filesystem::path path;
 
 	std::string title;
 	std::string front;
 	std::unique_ptr<Page::Image> back;
 
-	std::map<std::size_t, Page> pages;
+	// Every string in the book back to back. Pages and
+	// paragraphs are views into it.
+	std::vector<char> text;
+	std::vector<std::string_view> paragraphs;
+	std::vector<std::string_view> sounds;
+	std::vector<Markdown::Run> runs;
+	std::vector<Markdown::RunRange> paragraphRuns;
+
+	// Pages in order, and their numbers alongside
+	// for searching without touching the pages
+	std::vector<Page> pages;
+	std::vector<std::size_t> pageNumbers;
+
 	std::map<uint32_t, std::vector<std::string>> styles;
 
+	// Images replaced by Reload. Windowed decodes may still be
+	// writing into them, so they're kept until released.
+	std::vector<std::unique_ptr<Page::Image>> retiredImages;
+
 	LoadMode loadMode = LoadMode::Hard;
 
 	bool valid = true;
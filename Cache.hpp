@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <string>
+#include <thread>
+
+#include "Filesystem/FileRepository.hpp"
+
+using namespace SnobasteCPP;
+
+class Cache {
+public:
+	// Identifies one revision of a source file on disk
+	struct Stamp {
+		uint64_t size = 0;
+		int64_t time = 0;
+
+		bool operator==(const Stamp &right) const { return size == right.size && time == right.time; }
+		bool operator!=(const Stamp &right) const { return !(*this == right); }
+	};
+
+	static std::optional<Stamp> GetStamp(const std::filesystem::path &path) {
+		std::error_code error;
+		auto size = std::filesystem::file_size(path, error);
+		if (error) return std::nullopt;
+
+		auto time = std::filesystem::last_write_time(path, error);
+		if (error) return std::nullopt;
+
+		return Stamp{ size, static_cast<int64_t>(time.time_since_epoch().count()) };
+	}
+
+	// Cache subdirectory under the resource directory, created
+	// on demand. Failing to create it just means nothing will
+	// be cached.
+	static std::filesystem::path GetDirectory(const std::string &name) {
+		auto directory = FileRepository::registry->GetResourceDirectory() / "Cache" / name;
+
+		std::error_code error;
+		std::filesystem::create_directories(directory, error);
+
+		return directory;
+	}
+
+	// Write to a temporary file and swap it in, so readers
+	// never map a half-written file
+	static bool WriteAtomic(const std::filesystem::path &path, const void *data, std::size_t size) {
+		// Unique per thread, in case two workers write the same entry
+		auto temporary = path;
+		temporary += "." + std::to_string(std::hash<std::thread::id>()(std::this_thread::get_id())) + ".tmp";
+
+		{
+			std::ofstream outFile(temporary, std::ios::binary | std::ios::trunc);
+			if (!outFile) return false;
+
+			outFile.write(static_cast<const char *>(data), size);
+			if (!outFile) return false;
+		}
+
+		std::error_code error;
+		std::filesystem::rename(temporary, path, error);
+		if (error) {
+			std::filesystem::remove(temporary, error);
+			return false;
+		}
+
+		return true;
+	}
+};
\ No newline at end of file
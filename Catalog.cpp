@@ -0,0 +1,358 @@
+#include "Catalog.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <set>
+#include <stdexcept>
+
+#include "ImageCache.hpp"
+#include "ImagePipeline.hpp"
+#include "MappedFile.hpp"
+
+namespace {
+	class Writer {
+	public:
+		template<typename T>
+		void Put(T value) {
+			static_assert(std::is_trivially_copyable_v<T>);
+			auto bytes = reinterpret_cast<const uint8_t *>(&value);
+			data.insert(data.end(), bytes, bytes + sizeof(T));
+		}
+
+		void PutBytes(const void *bytes, std::size_t size) {
+			Put(static_cast<uint64_t>(size));
+			data.insert(data.end(), static_cast<const uint8_t *>(bytes), static_cast<const uint8_t *>(bytes) + size);
+		}
+
+		void PutString(const std::string &string) { PutBytes(string.data(), string.size()); }
+
+		std::vector<uint8_t> data;
+	};
+
+	class Reader {
+	public:
+		Reader(const uint8_t *data, std::size_t size) :
+			data(data),
+			size(size) {
+
+		}
+
+		template<typename T>
+		T Get() {
+			static_assert(std::is_trivially_copyable_v<T>);
+			T value;
+			std::memcpy(&value, Take(sizeof(T)), sizeof(T));
+			return value;
+		}
+
+		std::pair<const uint8_t *, std::size_t> GetBytes() {
+			auto length = Get<uint64_t>();
+			return { Take(length), static_cast<std::size_t>(length) };
+		}
+
+		std::string GetString() {
+			auto [bytes, length] = GetBytes();
+			return std::string(reinterpret_cast<const char *>(bytes), length);
+		}
+
+	private:
+		const uint8_t *Take(uint64_t length) {
+			if (length > size - pos)
+				throw std::runtime_error("Truncated catalog");
+
+			auto bytes = data + pos;
+			pos += length;
+			return bytes;
+		}
+
+		const uint8_t *data;
+		std::size_t size;
+		std::size_t pos = 0;
+	};
+}
+
+void Catalog::Load() {
+	MappedFile file(GetPath());
+	if (!file.IsOpen()) return;
+
+	try {
+		Reader reader(file.Data(), file.Size());
+
+		char magic[sizeof(Magic)];
+		for (auto &c : magic)
+			c = reader.Get<char>();
+		if (std::memcmp(magic, Magic, sizeof(Magic)) != 0 || reader.Get<uint32_t>() != Version)
+			throw std::runtime_error("Bad catalog header");
+
+		// Covers were scaled for a different display,
+		// so everything gets rebuilt
+		if (reader.Get<uint32_t>() != coverHeight)
+			return;
+
+		std::map<std::string, Record> loadedRecords;
+		for (auto count = reader.Get<uint64_t>(); count > 0; --count) {
+			auto path = reader.GetString();
+			Record record;
+
+			record.stamp.size = reader.Get<uint64_t>();
+			record.stamp.time = reader.Get<int64_t>();
+			record.coverStamp.size = reader.Get<uint64_t>();
+			record.coverStamp.time = reader.Get<int64_t>();
+			record.valid = reader.Get<uint8_t>();
+			record.test = reader.Get<uint8_t>();
+			record.title = reader.GetString();
+			record.front = reader.GetString();
+
+			for (auto pageCount = reader.Get<uint64_t>(); pageCount > 0; --pageCount) {
+				PageRecord page;
+				page.number = reader.Get<uint64_t>();
+				if (reader.Get<uint8_t>())
+					page.entryNumber = reader.Get<uint64_t>();
+				page.type = reader.Get<uint32_t>();
+				page.title = reader.GetString();
+				page.date = reader.GetString();
+				record.pages.emplace_back(std::move(page));
+			}
+
+			record.coverWidth = reader.Get<uint32_t>();
+			record.coverHeight = reader.Get<uint32_t>();
+			auto [png, pngSize] = reader.GetBytes();
+			record.coverPng.assign(png, png + pngSize);
+
+			loadedRecords.emplace(
+				std::make_pair(
+					std::move(path),
+					std::move(record)
+				)
+			);
+		}
+
+		std::lock_guard<std::mutex> lock(mutex);
+		records = std::move(loadedRecords);
+	}
+	catch (std::exception &e) {
+		logger.WriteDebug("Ignoring library catalog: ", e.what());
+	}
+}
+
+void Catalog::Save() {
+	Writer writer;
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+
+		for (auto c : Magic)
+			writer.Put(c);
+		writer.Put(Version);
+		writer.Put(coverHeight);
+
+		writer.Put(static_cast<uint64_t>(records.size()));
+		for (const auto &[path, record] : records) {
+			writer.PutString(path);
+			writer.Put(record.stamp.size);
+			writer.Put(record.stamp.time);
+			writer.Put(record.coverStamp.size);
+			writer.Put(record.coverStamp.time);
+			writer.Put<uint8_t>(record.valid);
+			writer.Put<uint8_t>(record.test);
+			writer.PutString(record.title);
+			writer.PutString(record.front);
+
+			writer.Put(static_cast<uint64_t>(record.pages.size()));
+			for (const auto &page : record.pages) {
+				writer.Put(page.number);
+				writer.Put<uint8_t>(page.entryNumber.has_value());
+				if (page.entryNumber)
+					writer.Put(*page.entryNumber);
+				writer.Put(page.type);
+				writer.PutString(page.title);
+				writer.PutString(page.date);
+			}
+
+			writer.Put(record.coverWidth);
+			writer.Put(record.coverHeight);
+			writer.PutBytes(record.coverPng.data(), record.coverPng.size());
+		}
+
+		dirty = false;
+	}
+
+	if (!Cache::WriteAtomic(GetPath(), writer.data.data(), writer.data.size()))
+		logger.WriteDebug("Failed to write library catalog");
+}
+
+std::optional<Catalog::Entry> Catalog::Find(const std::filesystem::path &path) {
+	auto stamp = Cache::GetStamp(path);
+	if (!stamp) return std::nullopt;
+
+	std::unique_lock<std::mutex> lock(mutex);
+
+	auto record = records.find(path.string());
+	if (record == records.end() || record->second.stamp != *stamp)
+		return std::nullopt;
+
+	// Records are never modified in place, only replaced
+	// by Build, so check the cover and decode it outside
+	// the lock
+	auto copy = record->second;
+	lock.unlock();
+
+	if (!copy.front.empty()) {
+		auto coverStamp = GetCoverStamp(copy.front);
+		if (!coverStamp || *coverStamp != copy.coverStamp)
+			return std::nullopt;
+	}
+
+	try {
+		return ToEntry(path, copy);
+	}
+	catch (std::exception &e) {
+		logger.WriteDebug("Ignoring catalog entry for ", path.string(), ": ", e.what());
+		return std::nullopt;
+	}
+}
+
+void Catalog::Build(const std::filesystem::path &path) {
+	Record record;
+
+	// Stamp before loading, so an edit made while we're
+	// parsing shows up as stale next time
+	if (auto stamp = Cache::GetStamp(path))
+		record.stamp = *stamp;
+
+	Entry entry{ Book(path, Book::LoadMode::Soft), {} };
+	const auto &book = entry.book;
+
+	record.valid = book.IsValid();
+	record.test = book.IsTest();
+	record.title = book.GetTitle();
+	record.front = book.GetFront();
+
+	for (const auto &page : book.GetPages()) {
+		PageRecord pageRecord;
+		pageRecord.number = page.number;
+		if (page.entryNumber)
+			pageRecord.entryNumber = *page.entryNumber;
+		pageRecord.type = static_cast<uint32_t>(page.type);
+		pageRecord.title = page.title;
+		pageRecord.date = page.date;
+		record.pages.emplace_back(std::move(pageRecord));
+	}
+
+	if (record.valid && !record.front.empty()) {
+		auto &cover = entry.cover;
+		cover.relativePath = record.front;
+
+		auto coverStamp = GetCoverStamp(record.front);
+		if (coverStamp)
+			record.coverStamp = *coverStamp;
+
+		uint64_t hash = 0;
+		if (cover.Decode(&hash) && cover.height) {
+			auto options = GetCoverOptions();
+			auto sourceWidth = cover.width, sourceHeight = cover.height;
+			ImagePipeline::Fit(cover.data, cover.width, cover.height, options.maxWidth, options.maxHeight);
+			cover.UpdateRatio();
+
+			record.coverWidth = cover.width;
+			record.coverHeight = cover.height;
+			fpng::fpng_encode_image_to_memory(cover.data.data(), cover.width, cover.height, 4, record.coverPng);
+
+			if (options.compress)
+				cover.Compress();
+			if (coverStamp)
+				ImageCache::Store(cover, options, *coverStamp, hash, sourceWidth, sourceHeight);
+		} else {
+			logger.WriteDebug("Failed to decode cover ", record.front);
+			std::vector<uint8_t>().swap(cover.data);
+		}
+	}
+
+	std::lock_guard<std::mutex> lock(mutex);
+	records[path.string()] = std::move(record);
+	built.emplace_back(std::move(entry));
+	dirty = true;
+}
+
+std::vector<Catalog::Entry> Catalog::TakeBuilt() {
+	std::lock_guard<std::mutex> lock(mutex);
+
+	std::vector<Entry> entries;
+	entries.swap(built);
+
+	return entries;
+}
+
+void Catalog::Retain(const std::vector<std::filesystem::path> &paths) {
+	std::set<std::string> keep;
+	for (const auto &path : paths)
+		keep.emplace(path.string());
+
+	std::lock_guard<std::mutex> lock(mutex);
+
+	for (auto record = records.begin(); record != records.end();) {
+		if (keep.find(record->first) == keep.end()) {
+			record = records.erase(record);
+			dirty = true;
+		} else {
+			++record;
+		}
+	}
+}
+
+Catalog::Entry Catalog::ToEntry(const std::filesystem::path &path, const Record &record) const {
+	Entry entry;
+
+	auto &book = entry.book;
+	book.path = path;
+	book.loadMode = Book::LoadMode::Soft;
+
+	CompiledBook::Writer writer;
+	writer.header.flags = record.test ? CompiledBook::HeaderTest : 0;
+	writer.header.title = writer.AddString(record.title);
+	writer.header.front = writer.AddString(record.front);
+
+	for (const auto &pageRecord : record.pages) {
+		CompiledBook::PageRecord page;
+		page.number = pageRecord.number;
+		if (pageRecord.entryNumber) {
+			page.entryNumber = *pageRecord.entryNumber;
+			page.flags |= CompiledBook::PageHasEntryNumber;
+		}
+		page.type = pageRecord.type;
+		page.title = writer.AddString(pageRecord.title);
+		page.date = writer.AddString(pageRecord.date);
+		writer.pages.push_back(page);
+	}
+
+	auto data = writer.Finish();
+	book.Load(CompiledBook::Reader(data.data(), data.size()));
+	book.valid = record.valid;
+
+	if (!record.coverPng.empty()) {
+		auto &cover = entry.cover;
+		cover.relativePath = record.front;
+
+		// The image cache holds the cover ready to upload,
+		// the catalog's PNG is the fallback
+		if (ImageCache::Load(cover, GetCoverOptions(), record.coverStamp))
+			return entry;
+
+		auto result = fpng::fpng_decode_memory(
+			record.coverPng.data(),
+			static_cast<uint32_t>(record.coverPng.size()),
+			cover.data,
+			cover.width,
+			cover.height,
+			cover.channels,
+			4
+		);
+		if (result != fpng::FPNG_DECODE_SUCCESS)
+			std::vector<uint8_t>().swap(cover.data);
+		cover.UpdateRatio();
+		if (GetCoverOptions().compress)
+			cover.Compress();
+	}
+
+	return entry;
+}
\ No newline at end of file
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <mutex>
+
+#include "Book.hpp"
+#include "Cache.hpp"
+#include "ImageCache.hpp"
+
+// On-disk index of the library, keyed by book path and stamp. Holds
+// each book's menu metadata and a pre-scaled, PNG-compressed cover
+// so an unchanged library can be listed from one file read.
+class Catalog : public LoggableClass {
+public:
+	static constexpr char Magic[8] = { 'C', 'H', 'C', 'A', 'T', 'L', 'G', '\0' };
+	static constexpr uint32_t Version = 2;
+
+	// A soft-loaded book and its decoded cover
+	struct Entry {
+		Book book;
+		Book::Page::Image cover;
+	};
+
+	// Covers are stored no taller than coverHeight
+	explicit Catalog(uint32_t coverHeight) :
+		coverHeight(coverHeight) {
+
+	}
+
+	void Load();
+	void Save();
+
+	// Returns the entry for path if it is up to date with the
+	// file on disk. Thread-safe.
+	std::optional<Entry> Find(const std::filesystem::path &path);
+
+	// Soft-loads the book at path, indexes it and queues the
+	// result for TakeBuilt. Thread-safe.
+	void Build(const std::filesystem::path &path);
+
+	// Entries finished by Build since the last call
+	std::vector<Entry> TakeBuilt();
+
+	// Drops entries for books no longer in the library
+	void Retain(const std::vector<std::filesystem::path> &paths);
+
+	bool IsDirty() {
+		std::lock_guard<std::mutex> lock(mutex);
+		return dirty;
+	}
+
+	static std::filesystem::path GetPath() { return Cache::GetDirectory("Catalog") / "library.chcat"; }
+
+private:
+	struct PageRecord {
+		uint64_t number = 0;
+		std::optional<uint64_t> entryNumber;
+		uint32_t type = 0;
+		std::string title;
+		std::string date;
+	};
+
+	struct Record {
+		Cache::Stamp stamp;
+		Cache::Stamp coverStamp;
+		bool valid = false;
+		bool test = false;
+		std::string title;
+		std::string front;
+		std::vector<PageRecord> pages;
+
+		uint32_t coverWidth = 0;
+		uint32_t coverHeight = 0;
+		std::vector<uint8_t> coverPng;
+	};
+
+	static std::optional<Cache::Stamp> GetCoverStamp(const std::string &front) {
+		return Cache::GetStamp(FileRepository::registry->GetResourceDirectory() / front);
+	}
+
+	ImageCache::Options GetCoverOptions() const {
+		return { "Cover", UINT32_MAX, coverHeight, ImagePipeline::IsCompressionEnabled() };
+	}
+
+	Entry ToEntry(const std::filesystem::path &path, const Record &record) const;
+
+	uint32_t coverHeight;
+
+	std::mutex mutex;
+	std::map<std::string, Record> records;
+	std::vector<Entry> built;
+	bool dirty = false;
+};
\ No newline at end of file
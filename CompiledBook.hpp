@@ -0,0 +1,279 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+// Binary layout of a compiled book (.chbook). Everything the JSON
+// source needs parsing for (stripped markdown, span runs, style
+// permutations) is stored ready to use in flat tables, so a book
+// can be read straight out of a memory-mapped file.
+//
+// All records are plain fixed-size structs, every table starts on
+// an 8-byte boundary and strings live in one blob at the end of the
+// file, referenced by offset and length.
+class CompiledBook {
+public:
+	static constexpr char Magic[8] = { 'C', 'H', 'B', 'O', 'O', 'K', '\0', '\0' };
+	static constexpr uint32_t Version = 3;
+
+	struct StringRef {
+		uint32_t offset = 0;
+		uint32_t length = 0;
+	};
+
+	// Slice of another table
+	struct Range {
+		uint32_t first = 0;
+		uint32_t count = 0;
+	};
+
+	struct Header {
+		char magic[8];
+		uint32_t version = Version;
+		uint32_t flags = 0;
+
+		// Stamp of the JSON source this was compiled from
+		uint64_t sourceSize = 0;
+		int64_t sourceTime = 0;
+
+		StringRef title;
+		StringRef front;
+		StringRef back;
+
+		Range pages;
+		Range paragraphs;
+		Range runs;
+		Range styles;
+		Range tokens;
+		Range sounds;
+
+		// Byte offsets of each table from the start of the file
+		uint64_t pagesOffset = 0;
+		uint64_t paragraphsOffset = 0;
+		uint64_t runsOffset = 0;
+		uint64_t stylesOffset = 0;
+		uint64_t tokensOffset = 0;
+		uint64_t soundsOffset = 0;
+		uint64_t stringsOffset = 0;
+		uint64_t stringsSize = 0;
+	};
+
+	enum HeaderFlags : uint32_t {
+		HeaderTest = 1 << 0
+	};
+
+	struct PageRecord {
+		uint64_t number = 0;
+		uint64_t entryNumber = 0;
+
+		// Hash of the page's JSON source, so a hot reload can
+		// tell which pages changed
+		uint64_t sourceHash = 0;
+
+		uint32_t flags = 0;
+		uint32_t type = 0;
+
+		StringRef title;
+		StringRef date;
+		StringRef font;
+		StringRef titleStyle;
+		StringRef image;
+
+		Range paragraphs;
+		Range sounds;
+	};
+
+	enum PageFlags : uint32_t {
+		PageHasEntryNumber = 1 << 0,
+		PageSpicy = 1 << 1,
+		PageHasImage = 1 << 2
+	};
+
+	struct ParagraphRecord {
+		StringRef text;
+		Range runs;
+	};
+
+	// One styled span: permutation hash and [begin, end) in
+	// the stripped paragraph text
+	struct RunRecord {
+		uint32_t style = 0;
+		uint32_t begin = 0;
+		uint32_t end = 0;
+	};
+
+	// Permutation hash and the tokens that make it up
+	struct StyleRecord {
+		uint32_t hash = 0;
+		Range tokens;
+	};
+
+	template <typename T>
+	class Table {
+	public:
+		Table() = default;
+		Table(const T *data, std::size_t count) :
+			data(data),
+			count(count) {
+
+		}
+
+		const T *begin() const { return data; }
+		const T *end() const { return data + count; }
+		std::size_t size() const { return count; }
+		bool empty() const { return count == 0; }
+
+		const T &operator[](std::size_t i) const { return data[i]; }
+
+		Table Slice(const Range &range) const {
+			if (static_cast<std::size_t>(range.first) + range.count > count)
+				throw std::out_of_range("Compiled book range out of bounds");
+
+			return Table(data + range.first, range.count);
+		}
+
+	private:
+		const T *data = nullptr;
+		std::size_t count = 0;
+	};
+
+	class Writer {
+	public:
+		StringRef AddString(std::string_view string) {
+			if (auto iter = interned.find(std::string(string)); iter != interned.end())
+				return iter->second;
+
+			StringRef ref{ static_cast<uint32_t>(strings.size()), static_cast<uint32_t>(string.size()) };
+			strings.append(string);
+			interned.emplace(std::string(string), ref);
+
+			return ref;
+		}
+
+		std::vector<uint8_t> Finish() {
+			std::vector<uint8_t> out(sizeof(Header));
+
+			header.pages = { 0, static_cast<uint32_t>(pages.size()) };
+			header.paragraphs = { 0, static_cast<uint32_t>(paragraphs.size()) };
+			header.runs = { 0, static_cast<uint32_t>(runs.size()) };
+			header.styles = { 0, static_cast<uint32_t>(styles.size()) };
+			header.tokens = { 0, static_cast<uint32_t>(tokens.size()) };
+			header.sounds = { 0, static_cast<uint32_t>(sounds.size()) };
+
+			header.pagesOffset = Append(out, pages);
+			header.paragraphsOffset = Append(out, paragraphs);
+			header.runsOffset = Append(out, runs);
+			header.stylesOffset = Append(out, styles);
+			header.tokensOffset = Append(out, tokens);
+			header.soundsOffset = Append(out, sounds);
+
+			header.stringsOffset = out.size();
+			header.stringsSize = strings.size();
+			out.insert(out.end(), strings.begin(), strings.end());
+
+			std::memcpy(header.magic, Magic, sizeof(Magic));
+			std::memcpy(out.data(), &header, sizeof(Header));
+
+			return out;
+		}
+
+		Header header;
+
+		std::vector<PageRecord> pages;
+		std::vector<ParagraphRecord> paragraphs;
+		std::vector<RunRecord> runs;
+		std::vector<StyleRecord> styles;
+		std::vector<StringRef> tokens;
+		std::vector<StringRef> sounds;
+
+	private:
+		template <typename T>
+		static uint64_t Append(std::vector<uint8_t> &out, const std::vector<T> &table) {
+			static_assert(std::is_trivially_copyable_v<T>);
+
+			// Keep every table 8-byte aligned
+			out.resize((out.size() + 7) & ~static_cast<std::size_t>(7));
+
+			auto offset = out.size();
+			out.resize(offset + table.size() * sizeof(T));
+			if (!table.empty())
+				std::memcpy(out.data() + offset, table.data(), table.size() * sizeof(T));
+
+			return offset;
+		}
+
+		std::string strings;
+		std::unordered_map<std::string, StringRef> interned;
+	};
+
+	// Validated view over a compiled book in memory. Throws
+	// if the buffer is not a well-formed compiled book.
+	class Reader {
+	public:
+		Reader(const uint8_t *data, std::size_t size) :
+			data(data),
+			size(size) {
+			if (!data || size < sizeof(Header))
+				throw std::runtime_error("Compiled book is truncated");
+
+			header = reinterpret_cast<const Header *>(data);
+			if (std::memcmp(header->magic, Magic, sizeof(Magic)) != 0 || header->version != Version)
+				throw std::runtime_error("Compiled book has the wrong version");
+
+			pages = GetTable<PageRecord>(header->pagesOffset, header->pages.count);
+			paragraphs = GetTable<ParagraphRecord>(header->paragraphsOffset, header->paragraphs.count);
+			runs = GetTable<RunRecord>(header->runsOffset, header->runs.count);
+			styles = GetTable<StyleRecord>(header->stylesOffset, header->styles.count);
+			tokens = GetTable<StringRef>(header->tokensOffset, header->tokens.count);
+			sounds = GetTable<StringRef>(header->soundsOffset, header->sounds.count);
+
+			if (header->stringsOffset > size || header->stringsSize > size - header->stringsOffset)
+				throw std::runtime_error("Compiled book string table out of bounds");
+			strings = reinterpret_cast<const char *>(data + header->stringsOffset);
+		}
+
+		const Header &GetHeader() const { return *header; }
+
+		const Table<PageRecord> &GetPages() const { return pages; }
+		const Table<ParagraphRecord> &GetParagraphs() const { return paragraphs; }
+		const Table<RunRecord> &GetRuns() const { return runs; }
+		const Table<StyleRecord> &GetStyles() const { return styles; }
+		const Table<StringRef> &GetTokens() const { return tokens; }
+		const Table<StringRef> &GetSounds() const { return sounds; }
+
+		std::string_view GetString(const StringRef &ref) const {
+			if (static_cast<uint64_t>(ref.offset) + ref.length > header->stringsSize)
+				throw std::out_of_range("Compiled book string out of bounds");
+
+			return std::string_view(strings + ref.offset, ref.length);
+		}
+
+	private:
+		template <typename T>
+		Table<T> GetTable(uint64_t offset, uint32_t count) const {
+			if (offset % alignof(T) != 0 || offset > size || static_cast<uint64_t>(count) * sizeof(T) > size - offset)
+				throw std::runtime_error("Compiled book table out of bounds");
+
+			return Table<T>(reinterpret_cast<const T *>(data + offset), count);
+		}
+
+		const uint8_t *data;
+		std::size_t size;
+
+		const Header *header = nullptr;
+		const char *strings = nullptr;
+
+		Table<PageRecord> pages;
+		Table<ParagraphRecord> paragraphs;
+		Table<RunRecord> runs;
+		Table<StyleRecord> styles;
+		Table<StringRef> tokens;
+		Table<StringRef> sounds;
+	};
+};
\ No newline at end of file
@@ -1,43 +1,223 @@
 #include "Curl.hpp"
 
+#include <algorithm>
+#include <cmath>
+
 #include "Renderer.hpp"
 
 constexpr float DEG2RAD = 3.14159f / 180.0f;
 
+namespace {
+	// The angle grows and then falls back exponentially at this rate,
+	// per second. It matches what the old per-frame step did at 60 FPS.
+	constexpr float CurlRate = 6.32f;
+	// How long falling from 90 degrees to one takes
+	const float FallTime = std::log(90.0f) / CurlRate;
+	// Below a degree it falls linearly, in degrees per second
+	constexpr float SettleRate = 6.67f;
+
+	// Longer frames only advance the turn this far, so a
+	// stall doesn't skip most of it
+	constexpr float MaxStep = 1.0f / 20.0f;
+
+	// Radians the page bends through, across its width, at its
+	// steepest. Flat at the start and end of the turn.
+	constexpr float Curvature = 0.6f;
+	// How much the page darkens as it turns edge on
+	constexpr float Shading = 0.35f;
+	// Darkness of the shadow, and its length for each pixel
+	// the page's edge is lifted
+	constexpr float ShadowAlpha = 0.4f;
+	constexpr float ShadowLength = 0.25f;
+
+	const char *VertexSource = R"(#version 330 core
+// Column and row, each 0 to 1, and whether this is the page or
+// its shadow. Shadow columns are 0 to 2: inner edge, under the
+// page's edge and the end of the shadow.
+layout(location = 0) in vec3 mesh;
+
+uniform mat4 projection;
+uniform mat4 modelview;
+
+// Page quad, x0 y0 x1 y1, and texture coordinates of its corners
+uniform vec4 rect;
+uniform vec2 texCoords[4];
+
+uniform float offset;
+uniform float angle;
+uniform float curvature;
+uniform float shading;
+uniform float shadowAlpha;
+uniform float shadowLength;
+
+out vec2 texCoord;
+out vec4 tint;
+flat out float textured;
+
+// Where the point r along the page from the axis ends up, across
+// the screen and out of it. The page bends through an arc, more
+// at its edge, and is a straight rotation when it doesn't.
+vec2 Bend(float r) {
+	if (abs(curvature) < 1e-6)
+		return vec2(r * cos(angle), -r * sin(angle));
+
+	float s = sign(r);
+	float a = angle + curvature * abs(r);
+	return vec2(s * (sin(a) - sin(angle)) / curvature, -s * (cos(angle) - cos(a)) / curvature);
+}
+
+void main() {
+	float y = mix(rect.y, rect.w, mesh.y);
+
+	if (mesh.z > 0.5) {
+		float r = mix(rect.x, rect.z, mesh.x) + offset;
+		vec2 bent = Bend(r);
+
+		// Lit from the viewer
+		float light = 1.0 - shading * (1.0 - abs(cos(angle + curvature * abs(r))));
+
+		texCoord = mix(mix(texCoords[0], texCoords[3], mesh.x), mix(texCoords[1], texCoords[2], mesh.x), mesh.y);
+		tint = vec4(light, light, light, 1.0);
+		textured = 1.0;
+		gl_Position = projection * modelview * vec4(bent.x, y, 0.0, 1.0);
+	} else {
+		float inner = abs(rect.x + offset) < abs(rect.z + offset) ? rect.x + offset : rect.z + offset;
+		float outer = abs(rect.x + offset) < abs(rect.z + offset) ? rect.z + offset : rect.x + offset;
+		vec2 edge = Bend(outer);
+
+		// Falls under the page and out past its edge, further
+		// the higher the edge is lifted
+		float x = mesh.x < 0.5 ? Bend(inner).x : edge.x;
+		if (mesh.x > 1.5)
+			x += sign(edge.x) * abs(edge.y) * shadowLength;
+
+		texCoord = vec2(0.0);
+		tint = vec4(0.0, 0.0, 0.0, mesh.x > 1.5 ? 0.0 : shadowAlpha);
+		textured = 0.0;
+		gl_Position = projection * modelview * vec4(x, y, 0.0, 1.0);
+	}
+}
+)";
+
+	const char *FragmentSource = R"(#version 330 core
+in vec2 texCoord;
+in vec4 tint;
+flat in float textured;
+
+uniform sampler2D image;
+
+out vec4 fragColor;
+
+void main() {
+	fragColor = (textured > 0.5 ? texture(image, texCoord) : vec4(1.0)) * tint;
+}
+)";
+}
+
 Curl::Curl(Renderer *renderer) :
 	renderer(renderer) {
 	rightPage.relativePath = "Images/rightpage.png";
 	leftPage.relativePath = "Images/leftpage.png";
 	leftPageMiddle.relativePath = "Images/leftpagemiddle.png";
 	leftPageOccupied.relativePath = "Images/leftpageoccupied.png";
-	rightPageShadow.relativePath = "Images/rightpageshadow.png";
-	fpng::fpng_decode_file(
-		std::filesystem::absolute(FileRepository::registry->GetResourceDirectory() / rightPageShadow.relativePath).string().c_str(),
-		rightPageShadow.data,
-		rightPageShadow.width,
-		rightPageShadow.height,
-		rightPageShadow.channels,
-		4
-	);
 }
 
 void Curl::Init() {
-	//renderer->LoadTexture(rightPage);
-	renderer->LoadTexture(rightPageShadow);
+#if defined(SNOBASTE_GL)
+	const auto compile = [&](GLenum type, const char *source) {
+		auto shader = glCreateShader(type);
+		glShaderSource(shader, 1, &source, nullptr);
+		glCompileShader(shader);
+
+		GLint status = GL_FALSE;
+		glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+		if (status != GL_TRUE) {
+			char log[1024] = {};
+			glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+			logger.WriteDebug("Curl shader failed to compile: ", log);
+		}
+
+		return shader;
+	};
+
+	auto vertexShader = compile(GL_VERTEX_SHADER, VertexSource);
+	auto fragmentShader = compile(GL_FRAGMENT_SHADER, FragmentSource);
+
+	program = glCreateProgram();
+	glAttachShader(program, vertexShader);
+	glAttachShader(program, fragmentShader);
+	glLinkProgram(program);
+	glDeleteShader(vertexShader);
+	glDeleteShader(fragmentShader);
+
+	GLint status = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &status);
+	if (status != GL_TRUE) {
+		logger.WriteDebug("Curl shader failed to link, turning pages flat");
+		glDeleteProgram(program);
+		program = 0;
+		return;
+	}
+
+	glUseProgram(program);
+	glUniform1i(glGetUniformLocation(program, "image"), 0);
+	glUniform1f(glGetUniformLocation(program, "shading"), Shading);
+	glUniform1f(glGetUniformLocation(program, "shadowAlpha"), ShadowAlpha);
+	glUniform1f(glGetUniformLocation(program, "shadowLength"), ShadowLength);
+	glUseProgram(0);
+
+	// The shadow's three columns, then the page's, two
+	// vertices each. Shadow first so the page covers it.
+	std::vector<float> vertices;
+	std::vector<unsigned short> indices;
+	const auto strip = [&](int columns, float step, float page) {
+		auto first = static_cast<unsigned short>(vertices.size() / 3);
+		for (int column = 0; column <= columns; ++column) {
+			for (float row : { 0.0f, 1.0f }) {
+				vertices.insert(vertices.end(), { column * step, row, page });
+			}
+
+			if (column == columns) continue;
+
+			auto top = static_cast<unsigned short>(first + column * 2);
+			indices.insert(indices.end(), {
+				top, static_cast<unsigned short>(top + 1), static_cast<unsigned short>(top + 3),
+				top, static_cast<unsigned short>(top + 3), static_cast<unsigned short>(top + 2)
+			});
+		}
+	};
+	strip(2, 1.0f, 0.0f);
+	strip(Columns, 1.0f / Columns, 1.0f);
+	indexCount = static_cast<GLsizei>(indices.size());
+
+	glGenVertexArrays(1, &vertexArray);
+	glGenBuffers(2, buffers);
+	glBindVertexArray(vertexArray);
+	glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(float), vertices.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[1]);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned short), indices.data(), GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, nullptr);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+#endif
 }
 
 void Curl::Resize(int width, int height) {
-	vertexBuffer[3] = shadowVertexBuffer[3] = height;
-	vertexBuffer[4] = shadowVertexBuffer[4] = width;
-	vertexBuffer[5] = shadowVertexBuffer[5] = height;
-	vertexBuffer[6] = shadowVertexBuffer[6] = width;
+	vertexBuffer[3] = height;
+	vertexBuffer[4] = width;
+	vertexBuffer[5] = height;
+	vertexBuffer[6] = width;
 }
 
 void Curl::Start(CurlDir curlDir, std::optional<std::function<void()>> callback) {
 	this->curlDir = curlDir;
 
 	angle = 0.0f;
-	shadowAngle = 0.0f;
+	elapsed = 0.0f;
 	animationState = AnimationState::FirstHalf;
 	this->callback = callback;
 }
@@ -55,89 +235,56 @@ void Curl::Update() {
 
 }
 
-void Curl::Render(GLuint texture, float x, float y, float *vertBuffer, const std::function<void(GLuint, float *, float *)> &f, float deltaTime, std::optional<float> fulcrum, bool cover, bool foreward, std::optional<std::reference_wrapper<std::unique_ptr<Book::Page::Image>>> back) {
-	memcpy(frameBufferVertexBuffer, vertBuffer, sizeof(float) * 8);
-
-	glTranslatef(fulcrum ? *fulcrum : x, y, 0.0f);
-
-	// Cast shadow before rotation
-		//glRotatef(shadowAngle, 0.0f, 1.0f, 0.0f);
-	shadowAngle = angle - 5.0f;
-	
-
-	//if (shadowAngle > 0.0f) {
-	shadowTextureBuffer[0] = shadowTextureBuffer[2] = (shadowAngle / 90.0f);
-	shadowTextureBuffer[4] = shadowTextureBuffer[6] = 1.0f - (shadowAngle / 90.0f);
-	shadowVertexBuffer[4] = shadowVertexBuffer[6] = frameBufferVertexBuffer[4] * (1.0f - shadowAngle / 90.0f);
-	
+void Curl::Render(GLuint texture, float x, float y, float *vertBuffer, float deltaTime, const float *texCoords, std::optional<float> fulcrum, bool cover, bool foreward, std::optional<std::reference_wrapper<std::unique_ptr<Book::Page::Image>>> back) {
 	if (animationState == AnimationState::FirstHalf) {
-		glRotatef(curlDir == CurlDir::Right ? shadowAngle : 180.0f - shadowAngle, 0.0f, 1.0f, 0.0f);
-
-		glColor4f(1.0f, 1.0f, 1.0f, std::clamp(sin(DEG2RAD * angle) * 2.0f, 0.0f, 1.0f));
-
-		renderer->RenderTexture(rightPageShadow, shadowVertexBuffer, shadowTextureBuffer, true);
-
-		glTranslatef(fulcrum ? *fulcrum : x, y, 0.0f);
-		//}
+		renderer->GetSprites().Translate(fulcrum ? *fulcrum : x, y, 0.0f);
 
-		glRotatef(angle, 0.0f, 1.0f, 0.0f);
-
-		if (fulcrum)
-			glTranslatef(x, 0.0f, 0.0f);
-
-		if (curlDir == CurlDir::Right)
-			frameBufferVertexBuffer[4] = frameBufferVertexBuffer[6] = (vertBuffer[4]) * (1.0f - sin(DEG2RAD * angle));
-		else
-			frameBufferVertexBuffer[0] = frameBufferVertexBuffer[2] = (vertBuffer[4]) * (sin(DEG2RAD * angle));
-		//textureBuffer[0] = textureBuffer[2] = (1.0f - ((angle - 1.0f) / 90.0f));
-
-		f(texture, frameBufferVertexBuffer, textureBuffer);
+		DrawPage(texture, vertBuffer, texCoords ? texCoords : textureBuffer, angle, fulcrum ? x : 0.0f);
 	} else {
-		glRotatef(curlDir == CurlDir::Right ? (90.0f + (90.0f - shadowAngle)) : shadowAngle, 0.0f, 1.0f, 0.0f);
-
-		glColor4f(1.0f, 1.0f, 1.0f, std::clamp(sin(DEG2RAD * angle) * 2.0f, 0.0f, 1.0f));
-		renderer->RenderTexture(rightPageShadow, shadowVertexBuffer, shadowTextureBuffer, true);
-
-		glTranslatef(fulcrum ? *fulcrum : x + 1 /* Avoid subpixel weirdness */, y, 0.0f);
+		renderer->GetSprites().Translate(fulcrum ? *fulcrum : x + 1 /* Avoid subpixel weirdness */, y, 0.0f);
 
 		// After 90 degrees, abandon FBO and render blank page
-		glRotatef(curlDir == CurlDir::Right ? (90.0f + (90.0f - angle)) : angle, 0.0f, 1.0f, 0.0f);
-
 		if (back) {
 			backVertexBuffer[3] = backVertexBuffer[5] = ((*back).get())->scaledHeight;
 			backVertexBuffer[4] = backVertexBuffer[6] = ((*back).get())->scaledWidth;
 		}
 
-		renderer->RenderTexture(
-			(back ? *((*back).get()) : cover ? (foreward ? leftPage : leftPageMiddle) : (curlDir == CurlDir::Right ? leftPageOccupied : rightPage)),
+		auto &image = back ? *((*back).get()) : cover ? (foreward ? leftPage : leftPageMiddle) : (curlDir == CurlDir::Right ? leftPageOccupied : rightPage);
+		float *backTexCoords = back ? textureBufferReverse : Renderer::GetTextureBuffer();
+		auto backTexture = renderer->GetImageTexture(image, backTexCoords);
+
+		DrawPage(
+			backTexture,
 			cover ? vertBuffer : back ? backVertexBuffer : vertexBuffer,
-			back ? textureBufferReverse : Renderer::GetTextureBuffer()
+			backTexCoords,
+			curlDir == CurlDir::Right ? 180.0f - angle : angle,
+			0.0f
 		);
 	}
 
-	glLoadIdentity();
+	renderer->GetSprites().LoadIdentity();
+
+	// Every frame of the turn is drawn, and the one after
+	// it so whatever the callback changes shows
+	renderer->Invalidate();
 
-	if (angle == 0.0f)
-		angle = 1.0f;
+	// The turn follows the clock rather than the frame count
+	elapsed += std::min(deltaTime, MaxStep);
 
 	if (animationState == AnimationState::FirstHalf) {
-		angle *= 1.0f + ((deltaTime / 0.0015f) * 0.01f);
+		angle = std::min(std::exp(CurlRate * elapsed), 90.0f);
+	} else if (elapsed < FallTime) {
+		angle = 90.0f * std::exp(-CurlRate * elapsed);
 	} else {
-		if (angle > 1.0f)
-			angle /= 1.0f + ((deltaTime / 0.0015f) * 0.01f);
-
 		// Switch to subtracting after passing 1.0 to
 		// avoid Zeno problem.
-		else
-			angle -= ((deltaTime / 0.0015f) * 0.01f);
-
-		if (angle < 0.0f)
-			angle = 0.0f;
+		angle = std::max(1.0f - SettleRate * (elapsed - FallTime), 0.0f);
 	}
 
 	if (angle >= 90.0f) {
 		// For now, stop the animation
 		animationState = AnimationState::SecondHalf;
+		elapsed = 0.0f;
 	} else if (angle <= 0.0f && animationState == AnimationState::SecondHalf) {
 		if (!renderedFinalFrame) {
 			renderedFinalFrame = true;
@@ -152,6 +299,52 @@ void Curl::Render(GLuint texture, float x, float y, float *vertBuffer, const std
 	}
 }
 
+void Curl::DrawPage(GLuint texture, const float *vertBuffer, const float *texCoords, float degrees, float offset) {
+	if (!program) {
+		auto &sprites = renderer->GetSprites();
+		sprites.Rotate(degrees, 0.0f, 1.0f, 0.0f);
+		sprites.Translate(offset, 0.0f, 0.0f);
+		sprites.SetColor(1.0f, 1.0f, 1.0f, 1.0f);
+		sprites.Draw(texture, vertBuffer, texCoords);
+		return;
+	}
+
+#if defined(SNOBASTE_GL)
+	// Whatever the renderer is holding goes under the page
+	auto &sprites = renderer->GetSprites();
+	sprites.Flush();
+
+	// Bends most when the page is upright
+	auto width = std::max(std::abs(vertBuffer[0] + offset), std::abs(vertBuffer[4] + offset));
+	auto curvature = width > 0.0f ? Curvature * std::sin(degrees * DEG2RAD) / width : 0.0f;
+
+	glUseProgram(program);
+	glUniformMatrix4fv(glGetUniformLocation(program, "projection"), 1, GL_FALSE, sprites.GetProjection());
+	glUniformMatrix4fv(glGetUniformLocation(program, "modelview"), 1, GL_FALSE, sprites.GetModelview());
+	glUniform4f(glGetUniformLocation(program, "rect"), vertBuffer[0], vertBuffer[1], vertBuffer[4], vertBuffer[3]);
+	glUniform2fv(glGetUniformLocation(program, "texCoords"), 4, texCoords);
+	glUniform1f(glGetUniformLocation(program, "offset"), offset);
+	glUniform1f(glGetUniformLocation(program, "angle"), degrees * DEG2RAD);
+	glUniform1f(glGetUniformLocation(program, "curvature"), curvature);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glBindVertexArray(vertexArray);
+	glDrawElements(GL_TRIANGLES, indexCount, GL_UNSIGNED_SHORT, nullptr);
+
+	glBindVertexArray(0);
+	glUseProgram(0);
+#endif
+}
+
 void Curl::Cleanup() {
+#if defined(SNOBASTE_GL)
+	if (program) {
+		glDeleteProgram(program);
+		glDeleteVertexArrays(1, &vertexArray);
+		glDeleteBuffers(2, buffers);
+	}
+#endif
 
+	program = vertexArray = 0;
 }
\ No newline at end of file
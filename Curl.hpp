@@ -5,7 +5,11 @@
 #include "Book.hpp"
 
 class Renderer;
-class Curl {
+
+// Turns a page over as a strip bent around a moving fold, shaded and
+// with the shadow it casts, in a vertex shader. The turn's angle is a
+// function of time, so it looks the same at any frame rate.
+class Curl : public LoggableClass {
 public:
 	enum class CurlDir {
 		Left,
@@ -21,29 +25,39 @@ public:
 	void Start(CurlDir curlDir, std::optional<std::function<void()>> callback = std::nullopt);
 	void Stop(bool withCallback = false);
 	void Update();
-	void Render(GLuint texture, float x, float y, float *vertBuffer, const std::function<void(GLuint, float *, float *)> &f, float deltaTime, std::optional<float> fulcrum = std::nullopt, bool cover = false, bool foreward = false, std::optional<std::reference_wrapper<std::unique_ptr<Book::Page::Image>>> back = std::nullopt);
+	// Draws texture turning about x, or fulcrum with the page moved
+	// to x, then advances the turn. texCoords replaces the page's
+	// usual texture coordinates.
+	void Render(GLuint texture, float x, float y, float *vertBuffer, float deltaTime, const float *texCoords = nullptr, std::optional<float> fulcrum = std::nullopt, bool cover = false, bool foreward = false, std::optional<std::reference_wrapper<std::unique_ptr<Book::Page::Image>>> back = std::nullopt);
 
 	void Cleanup();
 
 	bool IsAnimating() const { return animationState != AnimationState::None; }
 
 private:
+	// Columns the page is split into along its width
+	static constexpr int Columns = 32;
+
+	// Draws the quad in vertBuffer turned by degrees about the
+	// y axis, as glRotatef would, after moving it by offset
+	void DrawPage(GLuint texture, const float *vertBuffer, const float *texCoords, float degrees, float offset);
+
 	Renderer *renderer;
 
 	float vertexBuffer[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
 	float backVertexBuffer[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
-	float frameBufferVertexBuffer[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
 	float textureBuffer[8] = { 0, 1, 0, 0, 1, 0, 1, 1 };
 
-	float shadowVertexBuffer[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
-	float shadowTextureBuffer[8] = { 0, 0, 0, 1, 1, 1, 1, 0 };
-
 	float textureBufferReverse[8] = { 1.0f, 0, 1.0f, 1, 0.0f, 1, 0.0f, 0 };
 
-	Book::Page::Image rightPageShadow;
+	GLuint program = 0;
+	GLuint vertexArray = 0;
+	GLuint buffers[2] = { 0, 0 };
+	GLsizei indexCount = 0;
 
 	float angle = 0.0f;
-	float shadowAngle = 0.0f;
+	// Seconds into the current half of the turn
+	float elapsed = 0.0f;
 
 	enum class AnimationState {
 		None,
@@ -1,3 +1,21 @@
 #pragma once
 
-constexpr float FontScaleDelta = 0.05f;
\ No newline at end of file
+constexpr float FontScaleDelta = 0.05f;
+
+// Pages on either side of the current spread whose images
+// stay resident for windowed books
+constexpr std::size_t ImageWindowPages = 4;
+
+// Choices for the video memory setting, in megabytes.
+// Zero is unlimited.
+constexpr std::size_t VideoMemoryBudgets[] = { 256, 512, 1024, 2048, 0 };
+
+// Choices for the frame rate setting, in frames a second.
+// Zero only waits for the display.
+constexpr int FrameRateCaps[] = { 0, 30, 60, 120 };
+
+// Seconds autoplay leaves a finished spread up
+constexpr double AutoplayDelay = 2.0;
+
+// Decoded pixels held while they wait to be uploaded
+constexpr std::size_t PixelMemoryBudget = 512 * 1024 * 1024;
\ No newline at end of file
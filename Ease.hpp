@@ -1,42 +1,28 @@
 #pragma once
 
-template <typename T>
-class Ease {
-public:
-	Ease(T start, T end, float duration) :
-		start(start),
-		end(end),
-		duration(duration) {
-		passed = 0.0f;
-	}
-
-	T Advance(float delta) {
-		passed += delta;
-		value = start + EaseInCubic(passed / duration) * end;
-		return value;
-	}
-
-	const T Start() const {
-		return start;
-	}
-
-	const T End() const {
-		return end;
-	}
-
-	const T Value() const {
-		return value;
-	}
-
-private:
-	float EaseInCubic(float x) {
-		return x * x * x;
-	}
-
-	T start;
-	T end;
-	T value;
-
-	float duration = 0.0f;
-	float passed = 0.0f;
-};
\ No newline at end of file
+// Easing curves, each mapping progress in [0, 1] onto [0, 1]. They're
+// picked at compile time when a tween is started.
+namespace Ease {
+	struct Linear {
+		static float Apply(float x) { return x; }
+	};
+
+	struct InCubic {
+		static float Apply(float x) { return x * x * x; }
+	};
+
+	struct OutCubic {
+		static float Apply(float x) {
+			x = 1.0f - x;
+			return 1.0f - x * x * x;
+		}
+	};
+
+	struct InOutCubic {
+		static float Apply(float x) {
+			if (x < 0.5f) return 4.0f * x * x * x;
+			x = 2.0f - 2.0f * x;
+			return 1.0f - x * x * x / 2.0f;
+		}
+	};
+}
\ No newline at end of file
@@ -2,7 +2,9 @@
 
 #include "Audio.hpp"
 #include "Book.hpp"
+#include "FramePacer.hpp"
 #include "InputManager.hpp"
+#include "LoaderContext.hpp"
 #include "Menu.hpp"
 #include "Renderer.hpp"
 
@@ -16,6 +18,8 @@ public:
 
 	Engine(GLFWwindow *window) :
 		window(window),
+		pacer(std::make_unique<FramePacer>()),
+		loader(std::make_unique<LoaderContext>(window)),
 		audio(std::make_unique<Audio>(this)),
 		renderer(std::make_unique<Renderer>(this)),
 		manager(std::make_unique<InputManager>(this)),
@@ -27,17 +31,33 @@ public:
 	std::unique_ptr<Renderer> &GetRenderer() { return renderer; }
 	std::unique_ptr<InputManager> &GetManager() { return manager; }
 	std::unique_ptr<Menu> &GetMenu() { return menu; }
+	std::unique_ptr<LoaderContext> &GetLoader() { return loader; }
+	std::unique_ptr<FramePacer> &GetPacer() { return pacer; }
 
 	void SetBook(std::shared_ptr<Book> book) { this->book = book; renderer->SetBook(book); }
 	const std::shared_ptr<Book> &GetBook() const { return book; }
 
+	// Hot reload entry point for files changed on disk
+	void OnFilesChanged(const std::vector<std::filesystem::path> &paths) {
+		renderer->OnFilesChanged(paths);
+		menu->OnFilesChanged(paths);
+	}
+
 	const State &GetState() const { return state; }
-	void SetState(State state) { this->state = state; }
+	void SetState(State state) {
+		this->state = state;
+		pacer->Invalidate();
+	}
 
 	GLFWwindow *GetWindow() { return window; }
 private:
 	GLFWwindow *window = nullptr;
 
+	std::unique_ptr<FramePacer> pacer;
+
+	// Before the renderer, so it's torn down after it
+	std::unique_ptr<LoaderContext> loader;
+
 	std::unique_ptr<Renderer> renderer;
 	std::unique_ptr<InputManager> manager;
 	std::unique_ptr<Audio> audio;
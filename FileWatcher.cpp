@@ -0,0 +1,259 @@
+#include "FileWatcher.hpp"
+
+#include <algorithm>
+
+#if defined(__linux__)
+#include <sys/inotify.h>
+#include <unistd.h>
+#elif defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include "WorkerPool.hpp"
+#endif
+
+#if defined(_WIN32)
+struct FileWatcher::Overlapped {
+	OVERLAPPED overlapped = {};
+
+	// DWORD aligned, as ReadDirectoryChangesW needs
+	std::vector<DWORD> buffer = std::vector<DWORD>(16 * 1024);
+};
+#endif
+
+FileWatcher::FileWatcher(const std::filesystem::path &root, std::vector<std::string> ignored) :
+	root(std::filesystem::absolute(root).lexically_normal()),
+	ignored(std::move(ignored)) {
+#if defined(__linux__)
+	fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (fd < 0) {
+		logger.WriteDebug("Unable to start inotify, hot reload is disabled");
+		return;
+	}
+
+	Watch(this->root);
+#elif defined(_WIN32)
+	directory = CreateFileW(this->root.wstring().c_str(), FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, nullptr);
+	if (directory == INVALID_HANDLE_VALUE) {
+		directory = nullptr;
+		logger.WriteDebug("Unable to watch ", this->root.string(), ", hot reload is disabled");
+		return;
+	}
+
+	overlapped = std::make_unique<Overlapped>();
+	overlapped->overlapped.hEvent = CreateEventW(nullptr, TRUE, FALSE, nullptr);
+	Read();
+#else
+	// The first scan is only something to compare against
+	StartScan();
+#endif
+}
+
+FileWatcher::~FileWatcher() {
+#if defined(__linux__)
+	if (fd >= 0)
+		close(fd);
+#elif defined(_WIN32)
+	if (directory) {
+		// The read writes into our buffer until it's cancelled
+		DWORD length = 0;
+		if (CancelIoEx(directory, &overlapped->overlapped) || GetLastError() != ERROR_NOT_FOUND)
+			GetOverlappedResult(directory, &overlapped->overlapped, &length, TRUE);
+
+		CloseHandle(directory);
+	}
+	if (overlapped && overlapped->overlapped.hEvent)
+		CloseHandle(overlapped->overlapped.hEvent);
+#endif
+}
+
+std::vector<std::filesystem::path> FileWatcher::Poll() {
+#if defined(__linux__)
+	ReadEvents();
+
+	auto now = Clock::now();
+#elif defined(_WIN32)
+	ReadEvents();
+
+	auto now = Clock::now();
+#else
+	auto now = Clock::now();
+
+	std::optional<Stamps> current;
+	{
+		std::lock_guard<std::mutex> lock(scanned->mutex);
+		current.swap(scanned->stamps);
+	}
+
+	if (current) {
+		if (primed) {
+			for (const auto &[path, stamp] : *current) {
+				if (auto previous = stamps.find(path); previous == stamps.end() || previous->second != stamp)
+					pending[path] = now;
+			}
+		}
+
+		stamps = std::move(*current);
+		primed = true;
+		scanning = false;
+		lastScan = now;
+	}
+
+	if (!scanning && now - lastScan >= ScanInterval)
+		StartScan();
+#endif
+
+	std::vector<std::filesystem::path> settled;
+	for (auto file = pending.begin(); file != pending.end();) {
+		if (now - file->second >= SettleTime) {
+			settled.emplace_back(file->first);
+			file = pending.erase(file);
+		} else {
+			++file;
+		}
+	}
+
+	return settled;
+}
+
+bool FileWatcher::IsIgnored(const std::filesystem::path &root, const std::vector<std::string> &ignored, const std::filesystem::path &path) {
+	auto relative = path.lexically_relative(root);
+	if (relative.empty()) return false;
+
+	auto top = relative.begin()->string();
+	return std::find(ignored.begin(), ignored.end(), top) != ignored.end();
+}
+
+#if defined(__linux__)
+void FileWatcher::Watch(const std::filesystem::path &directory) {
+	if (IsIgnored(directory)) return;
+
+	auto wd = inotify_add_watch(fd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE | IN_DELETE_SELF);
+	if (wd < 0) {
+		logger.WriteDebug("Unable to watch ", directory.string());
+		return;
+	}
+	watches[wd] = directory;
+
+	std::error_code error;
+	for (const auto &entry : std::filesystem::directory_iterator(directory, error)) {
+		if (entry.is_directory(error))
+			Watch(entry.path().lexically_normal());
+	}
+}
+
+void FileWatcher::ReadEvents() {
+	if (fd < 0) return;
+
+	alignas(inotify_event) char buffer[4096];
+	while (true) {
+		auto length = read(fd, buffer, sizeof(buffer));
+		if (length <= 0) return;
+
+		auto now = Clock::now();
+		for (auto offset = 0; offset < length;) {
+			const auto *event = reinterpret_cast<const inotify_event *>(buffer + offset);
+			offset += sizeof(inotify_event) + event->len;
+
+			auto directory = watches.find(event->wd);
+			if (directory == watches.end()) continue;
+
+			if (event->mask & IN_IGNORED) {
+				watches.erase(directory);
+				continue;
+			}
+
+			if (!event->len) continue;
+
+			auto path = directory->second / event->name;
+			if (event->mask & IN_ISDIR) {
+				// Start watching directories as they appear
+				if (event->mask & (IN_CREATE | IN_MOVED_TO))
+					Watch(path);
+			} else if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO)) {
+				if (!IsIgnored(path))
+					pending[path] = now;
+			}
+		}
+	}
+}
+#elif defined(_WIN32)
+void FileWatcher::Read() {
+	ResetEvent(overlapped->overlapped.hEvent);
+
+	const auto size = static_cast<DWORD>(overlapped->buffer.size() * sizeof(DWORD));
+	if (!ReadDirectoryChangesW(directory, overlapped->buffer.data(), size, TRUE,
+		FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE, nullptr, &overlapped->overlapped, nullptr)) {
+		logger.WriteDebug("Unable to read changes under ", root.string(), ", hot reload is disabled");
+		CloseHandle(directory);
+		directory = nullptr;
+	}
+}
+
+void FileWatcher::ReadEvents() {
+	if (!directory) return;
+
+	DWORD length = 0;
+	if (!GetOverlappedResult(directory, &overlapped->overlapped, &length, FALSE)) {
+		if (GetLastError() != ERROR_IO_INCOMPLETE) {
+			logger.WriteDebug("Lost changes under ", root.string());
+			Read();
+		}
+		return;
+	}
+
+	// Nothing read means the buffer overflowed and
+	// this batch of changes is gone
+	if (!length)
+		logger.WriteDebug("Too many changes under ", root.string(), " at once, some were missed");
+
+	auto now = Clock::now();
+	const auto *data = reinterpret_cast<const uint8_t *>(overlapped->buffer.data());
+	for (std::size_t offset = 0; length;) {
+		const auto *info = reinterpret_cast<const FILE_NOTIFY_INFORMATION *>(data + offset);
+
+		if (info->Action == FILE_ACTION_ADDED || info->Action == FILE_ACTION_MODIFIED || info->Action == FILE_ACTION_RENAMED_NEW_NAME) {
+			auto path = (root / std::wstring(info->FileName, info->FileNameLength / sizeof(WCHAR))).lexically_normal();
+
+			std::error_code error;
+			if (!IsIgnored(path) && std::filesystem::is_regular_file(path, error))
+				pending[path] = now;
+		}
+
+		if (!info->NextEntryOffset) break;
+		offset += info->NextEntryOffset;
+	}
+
+	Read();
+}
+#else
+void FileWatcher::StartScan() {
+	scanning = true;
+	WorkerPool::Shared().Submit([scanned = scanned, root = root, ignored = ignored] {
+		auto current = Scan(root, ignored);
+
+		std::lock_guard<std::mutex> lock(scanned->mutex);
+		scanned->stamps = std::move(current);
+	});
+}
+
+FileWatcher::Stamps FileWatcher::Scan(const std::filesystem::path &root, const std::vector<std::string> &ignored) {
+	Stamps current;
+
+	std::error_code error;
+	for (auto entry = std::filesystem::recursive_directory_iterator(root, error); !error && entry != std::filesystem::recursive_directory_iterator(); entry.increment(error)) {
+		if (IsIgnored(root, ignored, entry->path())) {
+			entry.disable_recursion_pending();
+			continue;
+		}
+
+		if (entry->is_regular_file(error)) {
+			if (auto stamp = Cache::GetStamp(entry->path()))
+				current.emplace(entry->path().lexically_normal(), *stamp);
+		}
+	}
+
+	return current;
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "Filesystem/FileRepository.hpp"
+
+#include "Cache.hpp"
+
+using namespace SnobasteCPP;
+
+// Reports files that change under a directory tree. Uses inotify on
+// Linux and ReadDirectoryChangesW on Windows. Elsewhere it falls back
+// to comparing stamps, scanned periodically on a worker.
+class FileWatcher : public LoggableClass {
+public:
+	// How long a file must go without events before it's reported,
+	// so editors that save in several writes are only seen once
+	static constexpr std::chrono::milliseconds SettleTime{ 250 };
+	static constexpr std::chrono::milliseconds ScanInterval{ 1000 };
+
+	// Top-level directories named in ignored are not watched
+	FileWatcher(const std::filesystem::path &root, std::vector<std::string> ignored = {});
+	~FileWatcher();
+
+	FileWatcher(const FileWatcher &) = delete;
+	FileWatcher &operator=(const FileWatcher &) = delete;
+
+	// Changed files that have settled since the last call,
+	// as absolute, normalized paths. Never blocks.
+	std::vector<std::filesystem::path> Poll();
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	bool IsIgnored(const std::filesystem::path &path) const { return IsIgnored(root, ignored, path); }
+	static bool IsIgnored(const std::filesystem::path &root, const std::vector<std::string> &ignored, const std::filesystem::path &path);
+
+	std::filesystem::path root;
+	std::vector<std::string> ignored;
+
+	// Last event time for files that haven't settled yet
+	std::map<std::filesystem::path, Clock::time_point> pending;
+
+#if defined(__linux__)
+	void Watch(const std::filesystem::path &directory);
+	void ReadEvents();
+
+	int fd = -1;
+	std::map<int, std::filesystem::path> watches;
+#elif defined(_WIN32)
+	// Issues the next asynchronous read of changes
+	void Read();
+	void ReadEvents();
+
+	// The read in flight and the buffer it fills
+	struct Overlapped;
+
+	void *directory = nullptr;
+	std::unique_ptr<Overlapped> overlapped;
+#else
+	using Stamps = std::map<std::filesystem::path, Cache::Stamp>;
+
+	// A scan's result, handed over from the worker. Shared so a
+	// scan can outlive the watcher.
+	struct Scanned {
+		std::mutex mutex;
+		std::optional<Stamps> stamps;
+	};
+
+	// Stamps every file below root
+	static Stamps Scan(const std::filesystem::path &root, const std::vector<std::string> &ignored);
+	void StartScan();
+
+	Stamps stamps;
+	Clock::time_point lastScan;
+
+	std::shared_ptr<Scanned> scanned = std::make_shared<Scanned>();
+	bool scanning = false;
+	// Whether stamps holds a first scan to compare against
+	bool primed = false;
+#endif
+};
\ No newline at end of file
@@ -0,0 +1,80 @@
+#include "FramePacer.hpp"
+
+#include <algorithm>
+#include <thread>
+
+#include "GLFW/glfw3.h"
+
+FramePacer::FramePacer() {
+	glfwSwapInterval(1);
+}
+
+void FramePacer::SetTargetRate(int rate) {
+	targetRate = std::max(rate, 0);
+	next = Clock::now();
+}
+
+int FramePacer::GetRate() const {
+	if (focused && !iconified)
+		return targetRate;
+
+	return targetRate ? std::min(targetRate, BackgroundRate) : BackgroundRate;
+}
+
+void FramePacer::Wait() {
+	auto rate = GetRate();
+	if (!rate) return;
+
+	next += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / rate));
+
+	// Behind, so start over from now rather than
+	// rushing frames out to catch up
+	auto now = Clock::now();
+	if (next <= now) {
+		next = now;
+		return;
+	}
+
+	if (next - now > WakeEarly)
+		std::this_thread::sleep_until(next - WakeEarly);
+	while (Clock::now() < next)
+		std::this_thread::yield();
+}
+
+void FramePacer::Invalidate() {
+	dirty = true;
+
+	// Set before the loop checks for a frame, so either it
+	// sees the request or this sees it waiting
+	if (waiting)
+		glfwPostEmptyEvent();
+}
+
+void FramePacer::WakeAt(double time) {
+	if (!wakeup || time < *wakeup)
+		wakeup = time;
+}
+
+bool FramePacer::TakeFrame() {
+	if (wakeup && glfwGetTime() >= *wakeup) {
+		wakeup = std::nullopt;
+		return true;
+	}
+
+	return dirty.exchange(false);
+}
+
+void FramePacer::WaitEvents() {
+	waiting = true;
+
+	auto timeout = MaxIdle;
+	if (wakeup)
+		timeout = std::clamp(*wakeup - glfwGetTime(), 0.0, MaxIdle);
+
+	if (dirty || timeout <= 0.0)
+		glfwPollEvents();
+	else
+		glfwWaitEventsTimeout(timeout);
+
+	waiting = false;
+}
\ No newline at end of file
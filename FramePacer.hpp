@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <optional>
+
+#include "Filesystem/FileRepository.hpp"
+
+using namespace SnobasteCPP;
+
+// Keeps the main loop from drawing more often than it needs to. Swaps
+// wait for the display's vertical sync, frames can be capped below
+// that by sleeping, and an unfocused or minimized window only draws a
+// few times a second.
+//
+// Frames are only drawn on request, when something is invalidated or
+// a scheduled wakeup passes. In between, the loop blocks on window
+// events, so a still page costs next to nothing.
+class FramePacer : public LoggableClass {
+public:
+	// Frames a second while unfocused or minimized. Any slower
+	// and the timeline would start dropping time.
+	static constexpr int BackgroundRate = 15;
+
+	// Longest the loop blocks with nothing to draw, so
+	// the file watcher still gets polled
+	static constexpr double MaxIdle = 0.5;
+
+	// Needs the main window's context current
+	FramePacer();
+
+	// Frames a second, 0 to only wait for the display
+	void SetTargetRate(int rate);
+	int GetTargetRate() const { return targetRate; }
+
+	void SetFocused(bool focused) { this->focused = focused; }
+	void SetIconified(bool iconified) { this->iconified = iconified; }
+
+	// The cap in effect right now, 0 for none
+	int GetRate() const;
+
+	// Sleeps until the next frame is due. Called once a
+	// frame, after swapping.
+	void Wait();
+
+	// Asks for another frame as soon as the cap allows. Safe
+	// from any thread, waking the loop if it's blocked.
+	void Invalidate();
+	// Asks for a frame once glfwGetTime reaches time. Render
+	// thread only, the earliest wakeup wins.
+	void WakeAt(double time);
+
+	// Whether a frame is due, which uses up the request
+	bool TakeFrame();
+
+	// Handles window events, blocking until one comes in or
+	// the next wakeup if no frame is due
+	void WaitEvents();
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	// Sleeping can overshoot by about a scheduler tick, so
+	// wake this early and yield for the rest
+	static constexpr auto WakeEarly = std::chrono::milliseconds(1);
+
+	int targetRate = 0;
+	bool focused = true;
+	bool iconified = false;
+
+	Clock::time_point next = Clock::now();
+
+	std::atomic<bool> dirty = true;
+	std::atomic<bool> waiting = false;
+	std::optional<double> wakeup;
+};
\ No newline at end of file
@@ -1,5 +1,7 @@
 #include "GhostWriter.hpp"
 
+#include <algorithm>
+
 constexpr float CharTime = 0.05f;
 
 void GhostWriter::SetText(std::string &text, float totalTime) { 
@@ -18,11 +20,11 @@ void GhostWriter::SetText(std::string &text, float totalTime) {
 	}
 }
 
-std::pair<bool, std::string> GhostWriter::GetText(float deltaTime) { 
-	if (!string) return { false, "" };
+bool GhostWriter::Advance(float deltaTime) {
+	if (!string) return false;
 
 	accum += deltaTime;
-	if (accum >= (totalTime >= 0.0f ? totalTime / size : CharTime) && pos < string->get().size()) {
+	if (accum >= GetCharTime() && pos < string->get().size()) {
 		// Did we hit a Unicode character?
 		// Make sure to grab every byte.
 		if (string->get()[pos] & 0x80) {
@@ -30,10 +32,25 @@ std::pair<bool, std::string> GhostWriter::GetText(float deltaTime) {
 		} else {
 			++pos;
 		}
-		accum = accum - (totalTime >= 0.0f ? totalTime / size : CharTime);
+		accum = accum - GetCharTime();
+		return true;
 	}
 
-	auto test = string->get().substr(0, pos);
+	return false;
+}
+
+std::optional<float> GhostWriter::GetTimeToNext() const {
+	if (!string || pos >= string->get().size()) return std::nullopt;
+
+	return std::max(GetCharTime() - accum, 0.0f);
+}
+
+float GhostWriter::GetCharTime() const {
+	return totalTime >= 0.0f ? totalTime / size : CharTime;
+}
+
+std::pair<bool, std::string> GhostWriter::GetText() const {
+	if (!string) return { false, "" };
 
 	return { pos == string->get().size(),  string->get().substr(0, pos) };
 }
\ No newline at end of file
@@ -8,10 +8,19 @@ public:
 	GhostWriter() = default;
 
 	void SetText(std::string &text, float totalTime = -1.0f);
-	std::pair<bool, std::string> GetText(float deltaTime);
+	// Moves on by deltaTime, returning whether another
+	// character was revealed
+	bool Advance(float deltaTime);
+	// The text revealed so far, and whether that's all of it
+	std::pair<bool, std::string> GetText() const;
 	std::size_t GetPos() const { return pos; }
+	// Seconds until Advance reveals another character,
+	// nothing once they're all revealed
+	std::optional<float> GetTimeToNext() const;
 
 private:
+	float GetCharTime() const;
+
 	std::optional<std::reference_wrapper<std::string>> string = std::nullopt;
 	std::size_t pos = 0;
 	std::size_t size = 0;
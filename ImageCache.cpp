@@ -0,0 +1,168 @@
+#include "ImageCache.hpp"
+
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+
+#include "ImagePipeline.hpp"
+#include "MappedFile.hpp"
+
+namespace {
+	struct Header {
+		char magic[8];
+		uint32_t version;
+		uint32_t format;
+		uint64_t stampSize;
+		int64_t stampTime;
+		uint64_t sourceHash;
+		uint32_t sourceWidth, sourceHeight;
+		uint32_t width, height;
+		uint32_t boundWidth, boundHeight;
+		uint32_t levelCount;
+		uint32_t reserved;
+	};
+
+	struct LevelRecord {
+		uint32_t width, height;
+		uint64_t offset, size;
+	};
+}
+
+bool ImageCache::Load(Book::Page::Image &image, const Options &options, const Cache::Stamp &stamp) {
+	auto file = std::make_shared<MappedFile>(GetPath(options.kind, image.relativePath));
+	if (!file->IsOpen() || file->Size() < sizeof(Header)) return false;
+
+	Header header;
+	std::memcpy(&header, file->Data(), sizeof(Header));
+	if (std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 || header.version != Version)
+		return false;
+
+	// Pixels are only reusable if processing the source with these
+	// options would give the same result
+	auto [width, height] = ImagePipeline::FitSize(header.sourceWidth, header.sourceHeight, options.maxWidth, options.maxHeight);
+	if (width != header.width || height != header.height || (header.format != ImagePipeline::TextureData::RGBA8) != options.compress)
+		return false;
+
+	const auto levelsEnd = sizeof(Header) + static_cast<std::size_t>(header.levelCount) * sizeof(LevelRecord);
+	if (!header.levelCount || levelsEnd > file->Size())
+		return false;
+
+	ImagePipeline::TextureData upload;
+	upload.format = header.format;
+	for (uint32_t i = 0; i < header.levelCount; ++i) {
+		LevelRecord record;
+		std::memcpy(&record, file->Data() + sizeof(Header) + i * sizeof(LevelRecord), sizeof(LevelRecord));
+
+		if (record.size != ImagePipeline::TextureData::GetLevelSize(header.format, record.width, record.height) ||
+			record.offset > file->Size() - levelsEnd || record.size > file->Size() - levelsEnd - record.offset)
+			return false;
+
+		upload.levels.emplace_back(ImagePipeline::TextureData::Level{ record.width, record.height, static_cast<std::size_t>(record.offset), static_cast<std::size_t>(record.size) });
+	}
+
+	if (stamp.size == header.stampSize && stamp.time == header.stampTime) {
+		upload.mapping = file;
+		upload.mappingOffset = levelsEnd;
+	} else {
+		// Touched but maybe not changed, check the content
+		MappedFile source(FileRepository::registry->GetResourceDirectory() / image.relativePath);
+		if (!source.IsOpen() || Hash(source.Data(), source.Size()) != header.sourceHash)
+			return false;
+
+		// Take a copy and rewrite the entry with the new stamp,
+		// since the mapping can't be replaced while it's open
+		std::vector<uint8_t> entry(file->Data(), file->Data() + file->Size());
+		file.reset();
+
+		header.stampSize = stamp.size;
+		header.stampTime = stamp.time;
+		std::memcpy(entry.data(), &header, sizeof(Header));
+		Cache::WriteAtomic(GetPath(options.kind, image.relativePath), entry.data(), entry.size());
+
+		upload.storage.assign(entry.begin() + levelsEnd, entry.end());
+	}
+
+	std::vector<uint8_t>().swap(image.data);
+	image.upload = std::move(upload);
+	image.width = header.width;
+	image.height = header.height;
+	image.boundWidth = header.boundWidth;
+	image.boundHeight = header.boundHeight;
+	image.UpdateRatio();
+
+	return true;
+}
+
+void ImageCache::Store(const Book::Page::Image &image, const Options &options, const Cache::Stamp &stamp, uint64_t sourceHash, uint32_t sourceWidth, uint32_t sourceHeight) {
+	Header header{};
+	std::memcpy(header.magic, Magic, sizeof(Magic));
+	header.version = Version;
+	header.stampSize = stamp.size;
+	header.stampTime = stamp.time;
+	header.sourceHash = sourceHash;
+	header.sourceWidth = sourceWidth;
+	header.sourceHeight = sourceHeight;
+	header.width = image.width;
+	header.height = image.height;
+	header.boundWidth = image.boundWidth;
+	header.boundHeight = image.boundHeight;
+
+	std::vector<LevelRecord> records;
+	std::vector<std::pair<const uint8_t *, std::size_t>> levels;
+	uint64_t offset = 0;
+	if (!image.upload.levels.empty()) {
+		header.format = image.upload.format;
+		for (std::size_t i = 0; i < image.upload.levels.size(); ++i) {
+			const auto &level = image.upload.levels[i];
+			records.emplace_back(LevelRecord{ level.width, level.height, offset, level.size });
+			levels.emplace_back(image.upload.GetLevel(i), level.size);
+			offset += level.size;
+		}
+	} else if (!image.data.empty()) {
+		header.format = ImagePipeline::TextureData::RGBA8;
+		records.emplace_back(LevelRecord{ image.width, image.height, 0, image.data.size() });
+		levels.emplace_back(image.data.data(), image.data.size());
+		offset = image.data.size();
+	} else {
+		return;
+	}
+	header.levelCount = static_cast<uint32_t>(records.size());
+
+	std::vector<uint8_t> entry;
+	entry.reserve(sizeof(Header) + records.size() * sizeof(LevelRecord) + offset);
+	entry.insert(entry.end(), reinterpret_cast<const uint8_t *>(&header), reinterpret_cast<const uint8_t *>(&header) + sizeof(Header));
+	entry.insert(entry.end(), reinterpret_cast<const uint8_t *>(records.data()), reinterpret_cast<const uint8_t *>(records.data() + records.size()));
+	for (const auto &[data, size] : levels)
+		entry.insert(entry.end(), data, data + size);
+
+	Cache::WriteAtomic(GetPath(options.kind, image.relativePath), entry.data(), entry.size());
+}
+
+uint64_t ImageCache::Hash(const uint8_t *data, std::size_t size) {
+	// FNV-1a over whole words, the encoded files can be large
+	uint64_t hash = 14695981039346656037ull;
+	std::size_t i = 0;
+	for (; i + 8 <= size; i += 8) {
+		uint64_t word;
+		std::memcpy(&word, data + i, 8);
+		hash ^= word;
+		hash *= 1099511628211ull;
+	}
+	for (; i < size; ++i) {
+		hash ^= data[i];
+		hash *= 1099511628211ull;
+	}
+
+	return hash ^ size;
+}
+
+std::filesystem::path ImageCache::GetPath(std::string_view kind, const std::string &relativePath) {
+	std::string key(kind);
+	key += '/';
+	key += relativePath;
+
+	std::stringstream name;
+	name << std::hex << std::setw(16) << std::setfill('0') << Hash(reinterpret_cast<const uint8_t *>(key.data()), key.size()) << ".chimg";
+
+	return Cache::GetDirectory("Images") / name.str();
+}
\ No newline at end of file
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <string_view>
+
+#include "Book.hpp"
+#include "Cache.hpp"
+
+// Decoded, fitted and compressed images keyed by source path, so warm
+// starts map pixels straight into texture upload instead of decoding
+// PNGs. An entry is checked against its source's stamp and, when that
+// differs, the source's content hash, so touching a file keeps it.
+class ImageCache {
+public:
+	static constexpr char Magic[8] = { 'C', 'H', 'I', 'M', 'A', 'G', 'E', '\0' };
+	static constexpr uint32_t Version = 1;
+
+	// How the cached pixels were produced. Each kind of image
+	// gets its own entry per source.
+	struct Options {
+		std::string_view kind;
+		uint32_t maxWidth = UINT32_MAX;
+		uint32_t maxHeight = UINT32_MAX;
+		bool compress = false;
+	};
+
+	// Points image's upload data at a mapped entry if one matches
+	// the source at stamp and options. Thread-safe.
+	static bool Load(Book::Page::Image &image, const Options &options, const Cache::Stamp &stamp);
+
+	// Writes image's processed pixels for a source that decoded to
+	// sourceWidth x sourceHeight. Thread-safe.
+	static void Store(const Book::Page::Image &image, const Options &options, const Cache::Stamp &stamp, uint64_t sourceHash, uint32_t sourceWidth, uint32_t sourceHeight);
+
+	// Hash of an encoded source file
+	static uint64_t Hash(const uint8_t *data, std::size_t size);
+
+	static std::filesystem::path GetPath(std::string_view kind, const std::string &relativePath);
+};
\ No newline at end of file
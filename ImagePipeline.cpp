@@ -0,0 +1,341 @@
+#include "ImagePipeline.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define IMAGE_PIPELINE_SSE2
+#endif
+
+namespace {
+	// Sums each output column's span of RGBA8 source pixels
+	// into four 32-bit channels
+	void SumColumns(const uint8_t *row, const uint32_t *starts, const uint32_t *counts, uint32_t targetWidth, uint32_t *sums) {
+		for (uint32_t x = 0; x < targetWidth; ++x) {
+			const auto *source = row + static_cast<std::size_t>(starts[x]) * 4;
+			auto count = counts[x];
+			uint32_t i = 0;
+
+#if defined(__AVX2__)
+			auto wide = _mm256_setzero_si256();
+			for (; i + 2 <= count; i += 2, source += 8)
+				wide = _mm256_add_epi32(wide, _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(source))));
+			auto sum = _mm_add_epi32(_mm256_castsi256_si128(wide), _mm256_extracti128_si256(wide, 1));
+#elif defined(IMAGE_PIPELINE_SSE2)
+			const auto zero = _mm_setzero_si128();
+			auto sum = zero;
+			for (; i + 2 <= count; i += 2, source += 8) {
+				auto words = _mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(source)), zero);
+				sum = _mm_add_epi32(sum, _mm_add_epi32(_mm_unpacklo_epi16(words, zero), _mm_unpackhi_epi16(words, zero)));
+			}
+#endif
+
+#if defined(IMAGE_PIPELINE_SSE2)
+			if (i < count) {
+				int32_t pixel;
+				std::memcpy(&pixel, source, 4);
+				auto words = _mm_unpacklo_epi8(_mm_cvtsi32_si128(pixel), _mm_setzero_si128());
+				sum = _mm_add_epi32(sum, _mm_unpacklo_epi16(words, _mm_setzero_si128()));
+			}
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(sums + static_cast<std::size_t>(x) * 4), sum);
+#else
+			uint32_t sum[4] = { 0, 0, 0, 0 };
+			for (; i < count; ++i, source += 4) {
+				sum[0] += source[0];
+				sum[1] += source[1];
+				sum[2] += source[2];
+				sum[3] += source[3];
+			}
+			std::copy(sum, sum + 4, sums + static_cast<std::size_t>(x) * 4);
+#endif
+		}
+	}
+
+	void AddRow(uint32_t *accumulator, const uint32_t *row, std::size_t count) {
+		std::size_t i = 0;
+#if defined(__AVX2__)
+		for (; i + 8 <= count; i += 8) {
+			auto sum = _mm256_add_epi32(
+				_mm256_loadu_si256(reinterpret_cast<const __m256i *>(accumulator + i)),
+				_mm256_loadu_si256(reinterpret_cast<const __m256i *>(row + i))
+			);
+			_mm256_storeu_si256(reinterpret_cast<__m256i *>(accumulator + i), sum);
+		}
+#endif
+#if defined(IMAGE_PIPELINE_SSE2)
+		for (; i + 4 <= count; i += 4) {
+			auto sum = _mm_add_epi32(
+				_mm_loadu_si128(reinterpret_cast<const __m128i *>(accumulator + i)),
+				_mm_loadu_si128(reinterpret_cast<const __m128i *>(row + i))
+			);
+			_mm_storeu_si128(reinterpret_cast<__m128i *>(accumulator + i), sum);
+		}
+#endif
+		for (; i < count; ++i)
+			accumulator[i] += row[i];
+	}
+
+	// Divides each pixel's sums by its box size, rounding
+	void Normalize(const uint32_t *accumulator, const float *inverses, uint32_t targetWidth, uint8_t *out) {
+		for (uint32_t x = 0; x < targetWidth; ++x) {
+#if defined(IMAGE_PIPELINE_SSE2)
+			auto sum = _mm_cvtepi32_ps(_mm_loadu_si128(reinterpret_cast<const __m128i *>(accumulator + static_cast<std::size_t>(x) * 4)));
+			auto value = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(sum, _mm_set1_ps(inverses[x])), _mm_set1_ps(0.5f)));
+			auto bytes = _mm_packus_epi16(_mm_packs_epi32(value, value), value);
+			auto pixel = _mm_cvtsi128_si32(bytes);
+			std::memcpy(out + static_cast<std::size_t>(x) * 4, &pixel, 4);
+#else
+			for (int c = 0; c < 4; ++c)
+				out[x * 4 + c] = static_cast<uint8_t>(std::min(255.0f, accumulator[x * 4 + c] * inverses[x] + 0.5f));
+#endif
+		}
+	}
+}
+
+std::vector<uint8_t> ImagePipeline::Downscale(const std::vector<uint8_t> &pixels, uint32_t width, uint32_t height, uint32_t targetWidth, uint32_t targetHeight) {
+	targetWidth = std::clamp(targetWidth, 1u, width);
+	targetHeight = std::clamp(targetHeight, 1u, height);
+
+	if (targetWidth == width && targetHeight == height)
+		return pixels;
+
+	// Sums are 32-bit and normalized in float, so very large
+	// boxes go through an intermediate size to stay exact
+	if (width > targetWidth * MaxBox || height > targetHeight * MaxBox) {
+		auto intermediateWidth = std::min(width, targetWidth * MaxBox);
+		auto intermediateHeight = std::min(height, targetHeight * MaxBox);
+		return Downscale(Downscale(pixels, width, height, intermediateWidth, intermediateHeight), intermediateWidth, intermediateHeight, targetWidth, targetHeight);
+	}
+
+	std::vector<uint32_t> columnStarts(targetWidth), columnCounts(targetWidth);
+	for (uint32_t x = 0; x < targetWidth; ++x) {
+		auto x0 = static_cast<uint64_t>(x) * width / targetWidth;
+		auto x1 = std::max<uint64_t>(x0 + 1, static_cast<uint64_t>(x + 1) * width / targetWidth);
+		columnStarts[x] = static_cast<uint32_t>(x0);
+		columnCounts[x] = static_cast<uint32_t>(x1 - x0);
+	}
+
+	const auto rowSize = static_cast<std::size_t>(targetWidth) * 4;
+	std::vector<uint32_t> row(rowSize), accumulator(rowSize);
+	std::vector<float> inverses(targetWidth);
+	std::vector<uint8_t> out(rowSize * targetHeight);
+
+	// Each output row sums its source rows horizontally,
+	// then accumulates them vertically
+	for (uint32_t y = 0; y < targetHeight; ++y) {
+		auto y0 = static_cast<uint64_t>(y) * height / targetHeight;
+		auto y1 = std::max<uint64_t>(y0 + 1, static_cast<uint64_t>(y + 1) * height / targetHeight);
+
+		std::fill(accumulator.begin(), accumulator.end(), 0);
+		for (auto sy = y0; sy < y1; ++sy) {
+			SumColumns(&pixels[sy * width * 4], columnStarts.data(), columnCounts.data(), targetWidth, row.data());
+			AddRow(accumulator.data(), row.data(), rowSize);
+		}
+
+		for (uint32_t x = 0; x < targetWidth; ++x)
+			inverses[x] = 1.0f / (columnCounts[x] * static_cast<float>(y1 - y0));
+
+		Normalize(accumulator.data(), inverses.data(), targetWidth, &out[y * rowSize]);
+	}
+
+	return out;
+}
+
+std::pair<uint32_t, uint32_t> ImagePipeline::FitSize(uint32_t width, uint32_t height, uint32_t maxWidth, uint32_t maxHeight) {
+	if (!width || !height || (width <= maxWidth && height <= maxHeight))
+		return { width, height };
+
+	auto scale = std::min(maxWidth / static_cast<double>(width), maxHeight / static_cast<double>(height));
+	return {
+		std::clamp(static_cast<uint32_t>(std::lround(width * scale)), 1u, width),
+		std::clamp(static_cast<uint32_t>(std::lround(height * scale)), 1u, height)
+	};
+}
+
+void ImagePipeline::Fit(std::vector<uint8_t> &pixels, uint32_t &width, uint32_t &height, uint32_t maxWidth, uint32_t maxHeight) {
+	auto [targetWidth, targetHeight] = FitSize(width, height, maxWidth, maxHeight);
+	if (targetWidth == width && targetHeight == height)
+		return;
+
+	pixels = Downscale(pixels, width, height, targetWidth, targetHeight);
+	width = targetWidth;
+	height = targetHeight;
+}
+
+namespace {
+	uint16_t To565(const uint8_t *color) {
+		return static_cast<uint16_t>(((color[0] >> 3) << 11) | ((color[1] >> 2) << 5) | (color[2] >> 3));
+	}
+
+	void From565(uint16_t value, int *color) {
+		auto r = (value >> 11) & 31, g = (value >> 5) & 63, b = value & 31;
+		color[0] = (r << 3) | (r >> 2);
+		color[1] = (g << 2) | (g >> 4);
+		color[2] = (b << 3) | (b >> 2);
+	}
+
+	// Gathers the 4x4 block at bx, by, repeating edge pixels
+	// past the image bounds
+	void LoadBlock(const uint8_t *pixels, uint32_t width, uint32_t height, uint32_t bx, uint32_t by, uint8_t *block) {
+		for (uint32_t y = 0; y < 4; ++y) {
+			auto sy = std::min(by * 4 + y, height - 1);
+			for (uint32_t x = 0; x < 4; ++x) {
+				auto sx = std::min(bx * 4 + x, width - 1);
+				const auto *source = &pixels[(static_cast<std::size_t>(sy) * width + sx) * 4];
+				std::copy(source, source + 4, &block[(y * 4 + x) * 4]);
+			}
+		}
+	}
+
+	// Bounding box endpoints inset by a sixteenth of the range,
+	// which keeps outliers from stretching the palette
+	void EncodeColor(const uint8_t *block, uint8_t *out) {
+		uint8_t low[3] = { 255, 255, 255 }, high[3] = { 0, 0, 0 };
+		for (int i = 0; i < 16; ++i) {
+			for (int c = 0; c < 3; ++c) {
+				low[c] = std::min(low[c], block[i * 4 + c]);
+				high[c] = std::max(high[c], block[i * 4 + c]);
+			}
+		}
+		for (int c = 0; c < 3; ++c) {
+			auto inset = (high[c] - low[c]) >> 4;
+			low[c] += inset;
+			high[c] -= inset;
+		}
+
+		auto color0 = To565(high), color1 = To565(low);
+		if (color0 < color1)
+			std::swap(color0, color1);
+
+		out[0] = color0 & 0xFF;
+		out[1] = color0 >> 8;
+		out[2] = color1 & 0xFF;
+		out[3] = color1 >> 8;
+
+		uint32_t indices = 0;
+		if (color0 != color1) {
+			int palette[4][3];
+			From565(color0, palette[0]);
+			From565(color1, palette[1]);
+			for (int c = 0; c < 3; ++c) {
+				palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+				palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+			}
+
+			for (int i = 0; i < 16; ++i) {
+				int best = 0, bestDistance = INT32_MAX;
+				for (int p = 0; p < 4; ++p) {
+					int distance = 0;
+					for (int c = 0; c < 3; ++c) {
+						auto delta = block[i * 4 + c] - palette[p][c];
+						distance += delta * delta;
+					}
+					if (distance < bestDistance) {
+						bestDistance = distance;
+						best = p;
+					}
+				}
+				indices |= static_cast<uint32_t>(best) << (i * 2);
+			}
+		}
+
+		for (int i = 0; i < 4; ++i)
+			out[4 + i] = (indices >> (i * 8)) & 0xFF;
+	}
+
+	// Eight-value alpha ramp between the block's extremes
+	void EncodeAlpha(const uint8_t *block, uint8_t *out) {
+		uint8_t low = 255, high = 0;
+		for (int i = 0; i < 16; ++i) {
+			low = std::min(low, block[i * 4 + 3]);
+			high = std::max(high, block[i * 4 + 3]);
+		}
+
+		out[0] = high;
+		out[1] = low;
+
+		uint64_t indices = 0;
+		if (high != low) {
+			int palette[8] = { high, low };
+			for (int p = 2; p < 8; ++p)
+				palette[p] = ((8 - p) * high + (p - 1) * low) / 7;
+
+			for (int i = 0; i < 16; ++i) {
+				int best = 0, bestDistance = INT32_MAX;
+				for (int p = 0; p < 8; ++p) {
+					auto distance = std::abs(block[i * 4 + 3] - palette[p]);
+					if (distance < bestDistance) {
+						bestDistance = distance;
+						best = p;
+					}
+				}
+				indices |= static_cast<uint64_t>(best) << (i * 3);
+			}
+		}
+
+		for (int i = 0; i < 6; ++i)
+			out[2 + i] = (indices >> (i * 8)) & 0xFF;
+	}
+}
+
+ImagePipeline::TextureData ImagePipeline::Compress(const std::vector<uint8_t> &pixels, uint32_t width, uint32_t height) {
+	TextureData image;
+	if (!width || !height || pixels.size() < static_cast<std::size_t>(width) * height * 4)
+		return image;
+
+	bool opaque = true;
+	for (std::size_t i = 3; i < pixels.size() && opaque; i += 4)
+		opaque = pixels[i] == 255;
+
+	image.format = opaque ? TextureData::DXT1 : TextureData::DXT5;
+	const std::size_t blockSize = opaque ? 8 : 16;
+
+	// The mip chain adds about a third
+	image.storage.reserve(TextureData::GetLevelSize(image.format, width, height) * 4 / 3 + blockSize * 16);
+
+	std::vector<uint8_t> mip;
+	const auto *level = &pixels;
+	while (true) {
+		auto blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+
+		TextureData::Level compressed;
+		compressed.width = width;
+		compressed.height = height;
+		compressed.offset = image.storage.size();
+		compressed.size = blocksX * blocksY * blockSize;
+		image.storage.resize(compressed.offset + compressed.size);
+
+		uint8_t block[64];
+		for (uint32_t by = 0; by < blocksY; ++by) {
+			for (uint32_t bx = 0; bx < blocksX; ++bx) {
+				LoadBlock(level->data(), width, height, bx, by, block);
+
+				auto *out = &image.storage[compressed.offset + (static_cast<std::size_t>(by) * blocksX + bx) * blockSize];
+				if (!opaque) {
+					EncodeAlpha(block, out);
+					out += 8;
+				}
+				EncodeColor(block, out);
+			}
+		}
+		image.levels.emplace_back(compressed);
+
+		if (width == 1 && height == 1)
+			break;
+
+		auto nextWidth = std::max(1u, width / 2), nextHeight = std::max(1u, height / 2);
+		mip = Downscale(*level, width, height, nextWidth, nextHeight);
+		level = &mip;
+		width = nextWidth;
+		height = nextHeight;
+	}
+
+	return image;
+}
\ No newline at end of file
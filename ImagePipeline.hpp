@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "MappedFile.hpp"
+
+// CPU-side processing applied to decoded RGBA8 images
+// before they are uploaded
+class ImagePipeline {
+public:
+	// Box-filtered downscale of RGBA8 pixels to exactly
+	// targetWidth x targetHeight. Never upscales. Uses SSE2 or
+	// AVX2 when the build targets them.
+	static std::vector<uint8_t> Downscale(const std::vector<uint8_t> &pixels, uint32_t width, uint32_t height, uint32_t targetWidth, uint32_t targetHeight);
+
+	// Size Fit would give width x height
+	static std::pair<uint32_t, uint32_t> FitSize(uint32_t width, uint32_t height, uint32_t maxWidth, uint32_t maxHeight);
+
+	// Downscales in place to fit within maxWidth x maxHeight,
+	// keeping the aspect ratio
+	static void Fit(std::vector<uint8_t> &pixels, uint32_t &width, uint32_t &height, uint32_t maxWidth, uint32_t maxHeight);
+
+	// Largest size the current window can show a page image at.
+	// Decoded page images are fitted to it.
+	static void SetDisplayBound(uint32_t width, uint32_t height) {
+		displayWidth = width;
+		displayHeight = height;
+	}
+	static std::pair<uint32_t, uint32_t> GetDisplayBound() { return { displayWidth, displayHeight }; }
+
+	// Texture levels ready for upload, largest first. The bytes
+	// are either owned or mapped from the image cache.
+	struct TextureData {
+		// GL_RGBA, GL_COMPRESSED_RGB_S3TC_DXT1_EXT and
+		// GL_COMPRESSED_RGBA_S3TC_DXT5_EXT
+		static constexpr uint32_t RGBA8 = 0x1908;
+		static constexpr uint32_t DXT1 = 0x83F0;
+		static constexpr uint32_t DXT5 = 0x83F3;
+
+		struct Level {
+			uint32_t width = 0, height = 0;
+			std::size_t offset = 0, size = 0;
+		};
+
+		uint32_t format = 0;
+		std::vector<Level> levels;
+
+		std::vector<uint8_t> storage;
+		std::shared_ptr<const MappedFile> mapping;
+		std::size_t mappingOffset = 0;
+
+		bool IsCompressed() const { return format != RGBA8; }
+
+		const uint8_t *GetLevel(std::size_t level) const {
+			return (mapping ? mapping->Data() + mappingOffset : storage.data()) + levels[level].offset;
+		}
+
+		std::size_t Size() const {
+			std::size_t size = 0;
+			for (const auto &level : levels)
+				size += level.size;
+			return size;
+		}
+
+		// Bytes one level takes in format
+		static std::size_t GetLevelSize(uint32_t format, uint32_t width, uint32_t height) {
+			if (format == RGBA8)
+				return static_cast<std::size_t>(width) * height * 4;
+
+			return static_cast<std::size_t>((width + 3) / 4) * ((height + 3) / 4) * (format == DXT1 ? 8 : 16);
+		}
+	};
+
+	// Transcodes RGBA8 pixels to DXT1 when fully opaque and DXT5
+	// otherwise, box filtering each mip level from the one above
+	static TextureData Compress(const std::vector<uint8_t> &pixels, uint32_t width, uint32_t height);
+
+	// Compression is used once the renderer has found S3TC
+	// support and the player hasn't turned it off
+	static void SetCompressionSupported(bool supported) { compressionSupported = supported; }
+	static void SetCompressionEnabled(bool enabled) { compressionEnabled = enabled; }
+	static bool IsCompressionEnabled() { return compressionSupported && compressionEnabled; }
+
+private:
+	// Widest box Downscale averages in one pass
+	static constexpr uint32_t MaxBox = 64;
+
+	static inline std::atomic<uint32_t> displayWidth = UINT32_MAX;
+	static inline std::atomic<uint32_t> displayHeight = UINT32_MAX;
+
+	static inline std::atomic<bool> compressionSupported = false;
+	static inline std::atomic<bool> compressionEnabled = true;
+};
\ No newline at end of file
@@ -0,0 +1,305 @@
+#include "JsonScanner.hpp"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <stdexcept>
+
+char JsonScanner::Peek() {
+	SkipWhitespace();
+
+	if (pos >= size)
+		Fail("Unexpected end of JSON");
+
+	return data[pos];
+}
+
+void JsonScanner::BeginObject() {
+	Expect('{');
+	first = true;
+}
+
+bool JsonScanner::NextKey(std::string &key) {
+	if (Peek() == '}') {
+		++pos;
+		first = false;
+		return false;
+	}
+
+	if (!first)
+		Expect(',');
+	first = false;
+
+	key = ReadString();
+	Expect(':');
+
+	return true;
+}
+
+void JsonScanner::BeginArray() {
+	Expect('[');
+	first = true;
+}
+
+bool JsonScanner::NextElement() {
+	if (Peek() == ']') {
+		++pos;
+		first = false;
+		return false;
+	}
+
+	if (!first)
+		Expect(',');
+	first = false;
+
+	return true;
+}
+
+std::string JsonScanner::ReadString() {
+	Expect('"');
+
+	std::string out;
+	while (true) {
+		// Copy plain runs in one go
+		auto start = pos;
+		while (pos < size && data[pos] != '"' && data[pos] != '\\')
+			++pos;
+		out.append(data + start, pos - start);
+
+		if (pos >= size)
+			Fail("Unterminated JSON string");
+
+		if (data[pos++] == '"')
+			return out;
+
+		if (pos >= size)
+			Fail("Unterminated JSON escape");
+
+		switch (data[pos++]) {
+		case '"': out.push_back('"'); break;
+		case '\\': out.push_back('\\'); break;
+		case '/': out.push_back('/'); break;
+		case 'b': out.push_back('\b'); break;
+		case 'f': out.push_back('\f'); break;
+		case 'n': out.push_back('\n'); break;
+		case 'r': out.push_back('\r'); break;
+		case 't': out.push_back('\t'); break;
+		case 'u': {
+			auto codepoint = ReadHex4();
+
+			// Surrogate pair
+			if (codepoint >= 0xD800 && codepoint <= 0xDBFF && pos + 1 < size && data[pos] == '\\' && data[pos + 1] == 'u') {
+				pos += 2;
+				auto low = ReadHex4();
+				if (low >= 0xDC00 && low <= 0xDFFF)
+					codepoint = 0x10000 + ((codepoint - 0xD800) << 10) + (low - 0xDC00);
+			}
+
+			AppendCodepoint(out, codepoint);
+			break;
+		}
+		default:
+			Fail("Invalid JSON escape");
+		}
+	}
+}
+
+double JsonScanner::ReadNumber() {
+	SkipWhitespace();
+
+	// Copy out the token so strtod can't run past the buffer
+	auto start = pos;
+	while (pos < size && (std::isdigit(static_cast<unsigned char>(data[pos])) || data[pos] == '-' || data[pos] == '+' || data[pos] == '.' || data[pos] == 'e' || data[pos] == 'E'))
+		++pos;
+
+	if (start == pos)
+		Fail("Expected a JSON number");
+
+	std::string token(data + start, pos - start);
+	char *end = nullptr;
+	auto value = std::strtod(token.c_str(), &end);
+	if (end != token.c_str() + token.size())
+		Fail("Invalid JSON number");
+
+	return value;
+}
+
+bool JsonScanner::ReadBool() {
+	if (Peek() == 't') {
+		SkipLiteral("true");
+		return true;
+	}
+
+	SkipLiteral("false");
+	return false;
+}
+
+std::optional<uint64_t> JsonScanner::ReadOptionalInteger() {
+	if (Peek() == 'n') {
+		SkipLiteral("null");
+		return std::nullopt;
+	}
+
+	return static_cast<uint64_t>(ReadNumber());
+}
+
+std::string JsonScanner::ReadOptionalString() {
+	if (Peek() == 'n') {
+		SkipLiteral("null");
+		return {};
+	}
+
+	return ReadString();
+}
+
+bool JsonScanner::ReadOptionalBool(bool fallback) {
+	if (Peek() == 'n') {
+		SkipLiteral("null");
+		return fallback;
+	}
+
+	return ReadBool();
+}
+
+void JsonScanner::SkipValue() {
+	switch (Peek()) {
+	case '"':
+		SkipString();
+		break;
+	case 't':
+		SkipLiteral("true");
+		break;
+	case 'f':
+		SkipLiteral("false");
+		break;
+	case 'n':
+		SkipLiteral("null");
+		break;
+	case '{':
+	case '[': {
+		// Skip nested containers by depth, only looking
+		// inside strings for their closing quote
+		std::size_t depth = 0;
+		do {
+			SkipWhitespace();
+			if (pos >= size)
+				Fail("Unexpected end of JSON");
+
+			switch (data[pos]) {
+			case '{':
+			case '[':
+				++depth;
+				++pos;
+				break;
+			case '}':
+			case ']':
+				--depth;
+				++pos;
+				break;
+			case '"':
+				SkipString();
+				break;
+			default:
+				++pos;
+				break;
+			}
+		} while (depth > 0);
+
+		first = false;
+		break;
+	}
+	default:
+		ReadNumber();
+		break;
+	}
+}
+
+std::string_view JsonScanner::ReadRaw() {
+	SkipWhitespace();
+
+	auto start = pos;
+	SkipValue();
+
+	return std::string_view(data + start, pos - start);
+}
+
+void JsonScanner::SkipWhitespace() {
+	while (pos < size && (data[pos] == ' ' || data[pos] == '\t' || data[pos] == '\n' || data[pos] == '\r'))
+		++pos;
+}
+
+void JsonScanner::Expect(char c) {
+	if (Peek() != c)
+		Fail("Unexpected JSON character");
+
+	++pos;
+}
+
+void JsonScanner::SkipLiteral(std::string_view literal) {
+	SkipWhitespace();
+
+	if (std::string_view(data + pos, std::min(literal.size(), size - pos)) != literal)
+		Fail("Invalid JSON literal");
+
+	pos += literal.size();
+}
+
+void JsonScanner::SkipString() {
+	Expect('"');
+
+	while (pos < size) {
+		switch (data[pos++]) {
+		case '"':
+			return;
+		case '\\':
+			++pos;
+			break;
+		}
+	}
+
+	Fail("Unterminated JSON string");
+}
+
+void JsonScanner::AppendCodepoint(std::string &out, uint32_t codepoint) {
+	if (codepoint < 0x80) {
+		out.push_back(static_cast<char>(codepoint));
+	} else if (codepoint < 0x800) {
+		out.push_back(static_cast<char>(0xC0 | (codepoint >> 6)));
+		out.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+	} else if (codepoint < 0x10000) {
+		out.push_back(static_cast<char>(0xE0 | (codepoint >> 12)));
+		out.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+		out.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+	} else {
+		out.push_back(static_cast<char>(0xF0 | (codepoint >> 18)));
+		out.push_back(static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F)));
+		out.push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+		out.push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+	}
+}
+
+uint32_t JsonScanner::ReadHex4() {
+	if (pos + 4 > size)
+		Fail("Truncated JSON unicode escape");
+
+	uint32_t value = 0;
+	for (int i = 0; i < 4; ++i) {
+		char c = data[pos++];
+		value <<= 4;
+
+		if (c >= '0' && c <= '9')
+			value |= c - '0';
+		else if (c >= 'a' && c <= 'f')
+			value |= c - 'a' + 10;
+		else if (c >= 'A' && c <= 'F')
+			value |= c - 'A' + 10;
+		else
+			Fail("Invalid JSON unicode escape");
+	}
+
+	return value;
+}
+
+void JsonScanner::Fail(const char *message) const {
+	throw std::runtime_error(std::string(message) + " at offset " + std::to_string(pos));
+}
\ No newline at end of file
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+// Forward-only JSON reader over a buffer. Values are pulled one at
+// a time, and anything the caller doesn't ask for is skipped without
+// being built. Throws std::runtime_error on malformed input.
+class JsonScanner {
+public:
+	JsonScanner(const char *data, std::size_t size) :
+		data(data),
+		size(size) {
+		// Skip a UTF-8 byte order mark
+		if (size >= 3 && std::string_view(data, 3) == "\xEF\xBB\xBF")
+			pos = 3;
+	}
+
+	// Type of the next value: one of { [ " t f n, or a
+	// digit/minus for numbers
+	char Peek();
+
+	void BeginObject();
+
+	// Reads the next key of the current object. Returns
+	// false and consumes the '}' once the object ends.
+	bool NextKey(std::string &key);
+
+	void BeginArray();
+
+	// Returns false and consumes the ']' once the array
+	// ends, otherwise positions on the next element
+	bool NextElement();
+
+	std::string ReadString();
+	double ReadNumber();
+	bool ReadBool();
+
+	// Null-aware readers
+	std::optional<uint64_t> ReadOptionalInteger();
+	std::string ReadOptionalString();
+	bool ReadOptionalBool(bool fallback);
+
+	void SkipValue();
+
+	// Skips the next value and returns its source text
+	std::string_view ReadRaw();
+
+private:
+	void SkipWhitespace();
+	void Expect(char c);
+	void SkipLiteral(std::string_view literal);
+	void SkipString();
+	void AppendCodepoint(std::string &out, uint32_t codepoint);
+	uint32_t ReadHex4();
+
+	[[noreturn]] void Fail(const char *message) const;
+
+	const char *data;
+	std::size_t size;
+	std::size_t pos = 0;
+
+	// Whether the current object/array has had a member yet,
+	// so separators can be checked
+	bool first = true;
+};
\ No newline at end of file
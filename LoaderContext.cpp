@@ -0,0 +1,127 @@
+#include "LoaderContext.hpp"
+
+LoaderContext::LoaderContext(GLFWwindow *shared) {
+	// Same context version and profile as the main window,
+	// which are still hinted
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	window = glfwCreateWindow(1, 1, "", nullptr, shared);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+
+	if (!window) {
+		logger.WriteDebug("Unable to create a shared GL context, loading on the render thread");
+		return;
+	}
+
+	thread = std::thread(&LoaderContext::Work, this);
+}
+
+LoaderContext::~LoaderContext() {
+	Stop();
+
+	if (window)
+		glfwDestroyWindow(window);
+
+	for (auto &job : waiting) {
+		if (job.fence)
+			glDeleteSync(job.fence);
+	}
+}
+
+void LoaderContext::Submit(std::function<void()> job, std::function<void(bool)> ready) {
+	if (!IsAvailable()) {
+		ready(Run(job));
+		return;
+	}
+
+	++pending;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobs.emplace_back(std::move(job), std::move(ready));
+	}
+	condition.notify_one();
+}
+
+void LoaderContext::Poll() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		while (!finished.empty()) {
+			waiting.emplace_back(std::move(finished.front()));
+			finished.pop_front();
+		}
+	}
+
+	while (!waiting.empty()) {
+		auto &job = waiting.front();
+
+		if (job.fence) {
+			if (glClientWaitSync(job.fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+				return;
+
+			glDeleteSync(job.fence);
+		}
+
+		// Pop first, ready may submit more work
+		auto ready = std::move(job.ready);
+		auto succeeded = job.succeeded;
+		waiting.pop_front();
+		ready(succeeded);
+		--pending;
+	}
+}
+
+void LoaderContext::Stop() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	condition.notify_all();
+
+	if (thread.joinable())
+		thread.join();
+}
+
+void LoaderContext::Work() {
+	glfwMakeContextCurrent(window);
+
+	while (true) {
+		std::pair<std::function<void()>, std::function<void(bool)>> job;
+
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			condition.wait(lock, [&] { return stopping || !jobs.empty(); });
+
+			if (stopping && jobs.empty()) break;
+
+			job = std::move(jobs.front());
+			jobs.pop_front();
+		}
+
+		// The fence has to reach the GPU before the
+		// render thread can wait on it
+		Finished done;
+		done.succeeded = Run(job.first);
+#if defined(SNOBASTE_GL)
+		done.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		glFlush();
+#else
+		glFinish();
+#endif
+		done.ready = std::move(job.second);
+
+		std::lock_guard<std::mutex> lock(mutex);
+		finished.emplace_back(std::move(done));
+	}
+
+	glfwMakeContextCurrent(nullptr);
+}
+
+bool LoaderContext::Run(const std::function<void()> &job) {
+	try {
+		job();
+		return true;
+	}
+	catch (std::exception &e) {
+		logger.WriteDebug("Loader job failed: ", e.what());
+		return false;
+	}
+}
\ No newline at end of file
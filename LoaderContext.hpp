@@ -0,0 +1,75 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+
+#include "glad/glad.h"
+#include "GLFW/glfw3.h"
+
+#include "Filesystem/FileRepository.hpp"
+
+using namespace SnobasteCPP;
+
+// A hidden window whose GL context shares objects with the main one,
+// kept current on a thread of its own. Jobs there can create textures
+// and font atlases without holding up a frame. Each job is fenced, and
+// its ready callback runs on the render thread once the GPU is done
+// with it, told whether the job ran to the end.
+class LoaderContext : public LoggableClass {
+public:
+	// Main thread only, like all window creation
+	explicit LoaderContext(GLFWwindow *shared);
+	~LoaderContext();
+
+	LoaderContext(const LoaderContext &) = delete;
+	LoaderContext &operator=(const LoaderContext &) = delete;
+
+	// False if the shared context couldn't be created, in
+	// which case jobs run on the render thread
+	bool IsAvailable() const { return window != nullptr; }
+
+	// Runs job on the loader thread, then ready from Poll once
+	// whatever job created is usable from the render thread.
+	// ready gets false if job threw.
+	void Submit(std::function<void()> job, std::function<void(bool)> ready);
+
+	// Runs the ready callbacks of finished jobs, in the order
+	// they were submitted. Render thread only.
+	void Poll();
+
+	// Whether a submitted job's ready callback is still to run
+	bool IsBusy() const { return pending != 0; }
+
+	// Finishes queued jobs and releases the context. Ready
+	// callbacks that haven't run are dropped.
+	void Stop();
+
+private:
+	struct Finished {
+		GLsync fence = nullptr;
+		bool succeeded = true;
+		std::function<void(bool)> ready;
+	};
+
+	void Work();
+	// Runs job, logging rather than letting it throw
+	bool Run(const std::function<void()> &job);
+
+	GLFWwindow *window = nullptr;
+	std::thread thread;
+
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::deque<std::pair<std::function<void()>, std::function<void(bool)>>> jobs;
+	std::deque<Finished> finished;
+	bool stopping = false;
+
+	// Finished jobs whose fences haven't signalled yet
+	std::deque<Finished> waiting;
+
+	std::atomic<std::size_t> pending = 0;
+};
\ No newline at end of file
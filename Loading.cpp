@@ -35,6 +35,9 @@ void Loading::Resize(float width, float height) {
 void Loading::Draw(float delta, float x, float y) {
 	//renderer->RenderTexture(image);
 	indicator.Draw(delta, x + renderer->GetWidth() / 2.0f, y + renderer->GetHeight() / 2.0f);
+
+	// Spins for as long as it's shown
+	renderer->Invalidate();
 }
 void Loading::Cleanup() {
 	indicator.Cleanup();
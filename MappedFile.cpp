@@ -0,0 +1,105 @@
+#include "MappedFile.hpp"
+
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::filesystem::path &path) {
+#ifdef _WIN32
+	file = CreateFileW(path.wstring().c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (file == INVALID_HANDLE_VALUE) {
+		file = nullptr;
+		return;
+	}
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0) {
+		Close();
+		return;
+	}
+
+	mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (!mapping) {
+		Close();
+		return;
+	}
+
+	data = static_cast<const uint8_t *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+	if (!data) {
+		Close();
+		return;
+	}
+
+	size = static_cast<std::size_t>(fileSize.QuadPart);
+#else
+	int fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) return;
+
+	struct stat info;
+	if (fstat(fd, &info) != 0 || info.st_size == 0) {
+		close(fd);
+		return;
+	}
+
+	void *view = mmap(nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+	// The mapping holds its own reference to the file
+	close(fd);
+
+	if (view == MAP_FAILED) return;
+
+	data = static_cast<const uint8_t *>(view);
+	size = static_cast<std::size_t>(info.st_size);
+#endif
+}
+
+MappedFile::~MappedFile() {
+	Close();
+}
+
+MappedFile::MappedFile(MappedFile &&right) noexcept {
+	*this = std::move(right);
+}
+
+MappedFile &MappedFile::operator=(MappedFile &&right) noexcept {
+	if (this != &right) {
+		Close();
+
+		data = std::exchange(right.data, nullptr);
+		size = std::exchange(right.size, 0);
+#ifdef _WIN32
+		file = std::exchange(right.file, nullptr);
+		mapping = std::exchange(right.mapping, nullptr);
+#endif
+	}
+
+	return *this;
+}
+
+void MappedFile::Close() {
+#ifdef _WIN32
+	if (data)
+		UnmapViewOfFile(data);
+	if (mapping)
+		CloseHandle(mapping);
+	if (file)
+		CloseHandle(file);
+
+	mapping = nullptr;
+	file = nullptr;
+#else
+	if (data)
+		munmap(const_cast<uint8_t *>(data), size);
+#endif
+
+	data = nullptr;
+	size = 0;
+}
\ No newline at end of file
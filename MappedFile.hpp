@@ -0,0 +1,35 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+
+// Read-only memory mapping of a whole file. The mapping
+// lives as long as the object does.
+class MappedFile {
+public:
+	MappedFile() = default;
+	explicit MappedFile(const std::filesystem::path &path);
+	~MappedFile();
+
+	MappedFile(const MappedFile &) = delete;
+	MappedFile &operator=(const MappedFile &) = delete;
+
+	MappedFile(MappedFile &&right) noexcept;
+	MappedFile &operator=(MappedFile &&right) noexcept;
+
+	bool IsOpen() const { return data != nullptr; }
+
+	const uint8_t *Data() const { return data; }
+	std::size_t Size() const { return size; }
+
+private:
+	void Close();
+
+	const uint8_t *data = nullptr;
+	std::size_t size = 0;
+
+#ifdef _WIN32
+	void *file = nullptr;
+	void *mapping = nullptr;
+#endif
+};
\ No newline at end of file
@@ -0,0 +1,115 @@
+#include "Markdown.hpp"
+
+// MARKDOWN_NO_SIMD keeps to the scalar scan, for comparing the two
+#if !defined(MARKDOWN_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define MARKDOWN_SSE2
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+constexpr char TabReplacement[] = "          ";
+constexpr char TokenSeparator = '\x1f';
+
+constexpr uint32_t FnvOffset = 2166136261u;
+constexpr uint32_t FnvPrime = 16777619u;
+
+#ifdef MARKDOWN_SSE2
+static inline unsigned CountTrailingZeros(unsigned mask) {
+#ifdef _MSC_VER
+	unsigned long index;
+	_BitScanForward(&index, mask);
+	return index;
+#else
+	return __builtin_ctz(mask);
+#endif
+}
+#endif
+
+std::size_t Markdown::FindSpecial(const char *data, std::size_t size, std::size_t from) {
+	std::size_t i = from;
+
+#ifdef MARKDOWN_SSE2
+	const auto bracket = _mm_set1_epi8('[');
+	const auto tab = _mm_set1_epi8('\t');
+
+	for (; i + 16 <= size; i += 16) {
+		auto block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+		auto matches = _mm_or_si128(_mm_cmpeq_epi8(block, bracket), _mm_cmpeq_epi8(block, tab));
+
+		if (auto mask = static_cast<unsigned>(_mm_movemask_epi8(matches)))
+			return i + CountTrailingZeros(mask);
+	}
+#endif
+
+	for (; i < size; ++i) {
+		if (data[i] == '[' || data[i] == '\t')
+			return i;
+	}
+
+	return size;
+}
+
+uint32_t Markdown::HashPermutation(const std::vector<std::string> &permutation) {
+	uint32_t hash = FnvOffset;
+
+	for (const auto &token : permutation) {
+		for (auto c : token)
+			hash = (hash ^ static_cast<uint8_t>(c)) * FnvPrime;
+
+		hash = (hash ^ static_cast<uint8_t>(TokenSeparator)) * FnvPrime;
+	}
+
+	return hash;
+}
+
+std::string Markdown::Parse(std::string_view text, std::vector<Run> &runs, Permutations &permutations) {
+	std::string out;
+	out.reserve(text.size());
+
+	std::vector<std::string> tokenStack;
+	std::vector<uint32_t> startStack;
+
+	std::size_t c = 0;
+	while (c < text.size()) {
+		auto next = FindSpecial(text.data(), text.size(), c);
+		out.append(text.data() + c, next - c);
+		c = next;
+
+		if (c >= text.size()) break;
+
+		if (text[c] == '\t') {
+			out.append(TabReplacement, sizeof(TabReplacement) - 1);
+			++c;
+			continue;
+		}
+
+		// Read the token up to the closing bracket. An unterminated
+		// token swallows the rest of the text, like before.
+		auto close = text.find(']', c + 1);
+		auto token = text.substr(c + 1, (close == std::string_view::npos ? text.size() : close) - (c + 1));
+		c = close == std::string_view::npos ? text.size() : close + 1;
+
+		if (token.empty()) continue;
+
+		if (token.front() == '/') {
+			if (!tokenStack.empty() && tokenStack.back() == token.substr(1)) {
+				auto hash = HashPermutation(tokenStack);
+				if (permutations.find(hash) == permutations.end())
+					permutations.emplace(hash, tokenStack);
+
+				runs.push_back({ hash, startStack.back(), static_cast<uint32_t>(out.size()) });
+
+				startStack.pop_back();
+				tokenStack.pop_back();
+			}
+		} else {
+			startStack.push_back(static_cast<uint32_t>(out.size()));
+			tokenStack.emplace_back(token);
+		}
+	}
+
+	return out;
+}
\ No newline at end of file
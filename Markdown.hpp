@@ -1,5 +1,9 @@
 #pragma once
 
+#include <cstdint>
+#include <map>
+#include <string_view>
+
 #include "third_party/magic_enum/magic_enum.hpp"
 #include "Rendering/OpenGLFont.hpp"
 
@@ -7,6 +11,44 @@ using namespace SnobasteCPP;
 
 class Markdown {
 public:
+	// A styled span of stripped text: permutation hash and
+	// [begin, end) byte offsets
+	struct Run {
+		uint32_t style;
+		uint32_t begin;
+		uint32_t end;
+	};
+
+	// Runs belonging to a single paragraph
+	class RunRange {
+	public:
+		RunRange() = default;
+		RunRange(const Run *first, const Run *last) :
+			first(first),
+			last(last) {
+
+		}
+
+		const Run *begin() const { return first; }
+		const Run *end() const { return last; }
+		bool empty() const { return first == last; }
+
+	private:
+		const Run *first = nullptr;
+		const Run *last = nullptr;
+	};
+
+	using Permutations = std::map<uint32_t, std::vector<std::string>>;
+
+	// Strips [token]...[/token] markup out of text and expands tabs
+	// in a single forward pass. Appends one run per closed token
+	// to runs and registers every token stack seen in permutations.
+	static std::string Parse(std::string_view text, std::vector<Run> &runs, Permutations &permutations);
+
+	// Hash of a token stack. Tokens are separated so that
+	// different stacks can't produce the same key.
+	static uint32_t HashPermutation(const std::vector<std::string> &permutation);
+
 	static std::optional<OpenGLFont::SpanItem> GetSpanForMarkdown(const std::vector<std::string> &permutation) {
 		std::optional<OpenGLFont::Style> style = std::nullopt;
 		std::optional<Color> color = std::nullopt;
@@ -31,4 +73,9 @@ public:
 			return std::nullopt;
 		}
 	}
+
+private:
+	// Position of the next '[' or tab at or after from,
+	// or size if there is none
+	static std::size_t FindSpecial(const char *data, std::size_t size, std::size_t from);
 };
\ No newline at end of file
@@ -0,0 +1,143 @@
+// Times Markdown::Parse against the erase-based parser it replaced
+// on story paragraphs of a few sizes. Built by the
+// CHIPIVERSARY_BENCHMARKS option twice, with and without SIMD.
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <stack>
+
+#include "Utils/StringUtils.hpp"
+
+#include "Markdown.hpp"
+
+// Prose with a style every few sentences and the odd tab,
+// like the long stories that load slowest
+static std::string MakeParagraph(std::size_t size, std::mt19937 &random) {
+	static const char *words[] = {
+		"the", "morning", "light", "fell", "across", "an", "old", "wooden", "table", "while",
+		"somewhere", "outside", "birds", "argued", "about", "nothing", "in", "particular", "and", "she"
+	};
+	static const char *tokens[] = { "Bold", "Italic", "BoldItalic", "Red" };
+
+	std::string paragraph;
+	paragraph.reserve(size + 64);
+
+	std::uniform_int_distribution<std::size_t> word(0, std::size(words) - 1);
+	std::uniform_int_distribution<std::size_t> token(0, std::size(tokens) - 1);
+	std::uniform_int_distribution<int> roll(0, 99);
+	while (paragraph.size() < size) {
+		if (auto chance = roll(random); chance < 3) {
+			std::string name = tokens[token(random)];
+			paragraph += "[" + name + "]" + words[word(random)] + " " + words[word(random)] + "[/" + name + "] ";
+		} else if (chance < 4) {
+			paragraph += "\t";
+		} else {
+			paragraph += words[word(random)];
+			paragraph += ' ';
+		}
+	}
+
+	return paragraph;
+}
+
+// The parser Book::Page used before Markdown::Parse, kept as the
+// reference. It erases markup out of the paragraph in place, which
+// is quadratic in paragraph length.
+static std::string ReferenceParse(std::string_view text, std::vector<Markdown::Run> &runs, Markdown::Permutations &permutations) {
+	auto paragraph = StringUtils::ReplaceAll(std::string(text), "\t", "          ");
+
+	std::stack<std::size_t> startStack;
+	std::vector<std::string> tokenStack;
+	std::string token;
+	std::size_t i = 0;
+	for (auto c = paragraph.begin(); c != paragraph.end();) {
+		if (*c == '[') {
+			token.clear();
+			c = paragraph.erase(c);
+			while (c != paragraph.end() && *c != ']') {
+				token += *c;
+				c = paragraph.erase(c);
+			}
+			if (c != paragraph.end() && *c == ']')
+				c = paragraph.erase(c);
+
+			if (*token.begin() == '/') {
+				if (!tokenStack.empty() && *tokenStack.rbegin() == token.substr(1)) {
+					std::string permutationString;
+					for (const auto &permutation : tokenStack)
+						permutationString += permutation;
+
+					auto hash = StringUtils::fnv1a_32(permutationString);
+					permutations.emplace(hash, tokenStack);
+					runs.push_back({ hash, static_cast<uint32_t>(startStack.top()), static_cast<uint32_t>(i) });
+					startStack.pop();
+
+					tokenStack.pop_back();
+				}
+			} else {
+				startStack.push(i);
+
+				tokenStack.emplace_back(token);
+			}
+		} else {
+			++i;
+			++c;
+		}
+	}
+
+	return paragraph;
+}
+
+// Best and median MB/s of parse over paragraphs
+template <typename Parse>
+static std::pair<double, double> Time(const std::vector<std::string> &paragraphs, std::size_t bytes, Parse parse) {
+	std::vector<double> rates;
+	std::size_t checksum = 0;
+	for (int repeat = 0; repeat < 9; ++repeat) {
+		std::vector<Markdown::Run> runs;
+		Markdown::Permutations permutations;
+
+		auto start = std::chrono::steady_clock::now();
+		for (const auto &paragraph : paragraphs) {
+			runs.clear();
+			checksum += parse(paragraph, runs, permutations).size() + runs.size();
+		}
+		std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+		rates.emplace_back(bytes / elapsed.count() / (1024.0 * 1024.0));
+	}
+	std::sort(rates.begin(), rates.end());
+
+	// Keeps the parse from being optimized out
+	if (!checksum)
+		std::exit(1);
+
+	return { rates.back(), rates[rates.size() / 2] };
+}
+
+int main() {
+	std::mt19937 random(2024);
+
+	std::cout << "size\tparagraphs\treference best MB/s\treference median MB/s\tbest MB/s\tmedian MB/s\tspeedup" << std::endl;
+	for (std::size_t size : { 1024, 4096, 16384, 65536 }) {
+		// About 16 MB of text per size, so the
+		// smaller ones aren't over in a blink
+		const auto count = std::max<std::size_t>(16 * 1024 * 1024 / size, 1);
+		std::vector<std::string> paragraphs;
+		std::size_t bytes = 0;
+		for (std::size_t i = 0; i < count; ++i) {
+			paragraphs.emplace_back(MakeParagraph(size, random));
+			bytes += paragraphs.back().size();
+		}
+
+		auto [referenceBest, referenceMedian] = Time(paragraphs, bytes, ReferenceParse);
+		auto [best, median] = Time(paragraphs, bytes, Markdown::Parse);
+
+		std::cout << size << "\t" << count << "\t" << referenceBest << "\t" << referenceMedian << "\t" << best << "\t" << median << "\t" << median / referenceMedian << "x" << std::endl;
+	}
+
+	return 0;
+}
\ No newline at end of file
@@ -1,5 +1,6 @@
 #include "Menu.hpp"
 
+#include <algorithm>
 #include <thread>
 
 #include <glad/glad.h>
@@ -9,6 +10,7 @@
 
 #include "Defines.hpp"
 #include "Engine.hpp"
+#include "WorkerPool.hpp"
 
 Menu::AnimationState &operator++(Menu::AnimationState &c) {
 	using IntType = typename std::underlying_type<Menu::AnimationState>::type;
@@ -84,6 +86,14 @@ Menu::Menu(Engine *engine) :
 				FileRepository::registry->SetSetting(item.settingKey, item.value);
 			}
 		},
+		{ "Frame Rate", "Caps how often the screen is redrawn, to save power", "FrameRate", 0, [&](MenuItem &item, bool init) {
+				if (!init && ++item.value >= item.settingValues.size())
+					item.value = 0;
+
+				this->engine->GetPacer()->SetTargetRate(FrameRateCaps[item.value]);
+				FileRepository::registry->SetSetting(item.settingKey, item.value);
+			}
+		},
 		{ "Audio", "Toggles voiceover readings of poems and stories", "Audio", 1, [&](MenuItem &item, bool init) {
 				item.value = !item.value;
 				this->engine->GetAudio()->Reset();
@@ -100,6 +110,20 @@ Menu::Menu(Engine *engine) :
 				FileRepository::registry->SetSetting(item.settingKey, item.value);
 			}
 		},
+		{ "Compressed Images", "Saves video memory on image-heavy books, from the next one opened", "CompressTextures", 1, [&](MenuItem &item, bool init) {
+				item.value = !item.value;
+				ImagePipeline::SetCompressionEnabled(item.value);
+				FileRepository::registry->SetSetting(item.settingKey, item.value);
+			}
+		},
+		{ "Video Memory", "Caps memory for images, reading older ones again when needed", "VideoMemory", 2, [&](MenuItem &item, bool init) {
+				if (!init && ++item.value >= item.settingValues.size())
+					item.value = 0;
+
+				this->engine->GetRenderer()->SetMemoryBudget(VideoMemoryBudgets[item.value] * 1024 * 1024);
+				FileRepository::registry->SetSetting(item.settingKey, item.value);
+			}
+		},
 		{ back, [&](MenuItem &item, bool init) {
 				SetCurrentMenuItems(&mainMenuItems);
 			}
@@ -117,6 +141,27 @@ Menu::Menu(Engine *engine) :
 		}
 	}
 
+	auto &memorySetting = settingsMenuItems.items[settingsMenuItems.keyedItems.at("VideoMemory")];
+	for (auto budget : VideoMemoryBudgets) {
+		if (!budget)
+			memorySetting.settingValues.emplace_back("Unlimited");
+		else if (budget % 1024 == 0)
+			memorySetting.settingValues.emplace_back(std::to_string(budget / 1024) + " GB");
+		else
+			memorySetting.settingValues.emplace_back(std::to_string(budget) + " MB");
+	}
+
+	if (memorySetting.value < 0 || memorySetting.value >= memorySetting.settingValues.size())
+		memorySetting.value = memorySetting.defaultValue;
+
+	auto &frameRateSetting = settingsMenuItems.items[settingsMenuItems.keyedItems.at("FrameRate")];
+	for (auto rate : FrameRateCaps)
+		frameRateSetting.settingValues.emplace_back(rate ? std::to_string(rate) + " FPS" : "Display");
+
+	if (frameRateSetting.value < 0 || frameRateSetting.value >= frameRateSetting.settingValues.size())
+		frameRateSetting.value = frameRateSetting.defaultValue;
+	frameRateSetting.onClicked(frameRateSetting, true);
+
 	checkbox.SetColor(Color::ChipTan);
 	checkbox.SetObjectScale(1.75f);
 
@@ -136,6 +181,8 @@ Menu::MenuItems *Menu::GetBookMenuItems() {
 
 		}
 		virtual ~BookMenuItems() {
+			if (menu->shownBookMenuItems == this)
+				menu->shownBookMenuItems = nullptr;
 			menu->scrollbarXPos = 0.0f;
 			menu->hoveredOverScrollbar = false;
 			menu->draggingScrollbar = false;
@@ -148,8 +195,16 @@ Menu::MenuItems *Menu::GetBookMenuItems() {
 
 	// Assemble menu items for books
 	BookMenuItems *bookMenuItems = new BookMenuItems(this);
+	shownBookMenuItems = bookMenuItems;
+
+	// Books arrive in whatever order their workers finish, so list
+	// them by path to keep cold and warm starts the same
+	std::vector<std::reference_wrapper<const Book>> sortedBooks(books.begin(), books.end());
+	std::sort(sortedBooks.begin(), sortedBooks.end(), [](const Book &a, const Book &b) {
+		return a.GetPath() < b.GetPath();
+	});
 
-	for (const auto &book : books) {
+	for (const Book &book : sortedBooks) {
 		bookMenuItems->items.emplace_back(
 			MenuItem(
 				book.GetTitle(),
@@ -187,9 +242,11 @@ Menu::MenuItems *Menu::GetMenuItemsForBook(const Book &book) {
 		auto path = book.GetPath();
 
 		const auto animate = [&](MenuItem &item, bool init) {
-			selectedPage = page.first;
+			selectedPage = page.number;
 			animationState = AnimationState::Fade;
-			ease = std::make_unique<Ease<float>>(0.0f, 1.0f, 0.5f);
+			auto &timeline = engine->GetRenderer()->GetTimeline();
+			timeline.Stop(ease);
+			ease = timeline.Start(0.0f, 1.0f, 0.5f, [this] { NextAnimation(); });
 
 			if (auto currentBook = engine->GetBook(); !currentBook || currentBook->GetTitle() != selectedBook->get().GetTitle()) {
 				loaded = false;
@@ -198,24 +255,22 @@ Menu::MenuItems *Menu::GetMenuItemsForBook(const Book &book) {
 
 				auto path = selectedBook->get().GetPath();
 				std::thread([&, path] {
-					auto book = std::make_shared<Book>(path);
+					auto book = std::make_shared<Book>(path, Book::LoadMode::Windowed);
 					loaded = true;
 					std::unique_lock<std::mutex> lock(loadingMutex);
 
 					engine->SetBook(book);
 					engine->GetRenderer()->SetPage(selectedPage, true);
 					engine->SetState(Engine::State::Book);
-
-					ease.reset();
 				}).detach();
 			}
 		};
 
-		if (!page.second.title.empty()) {
+		if (!page.title.empty()) {
 			std::stringstream stream;
-			if (page.second.entryNumber)
-				stream << "#" << *page.second.entryNumber << u8" \u2014 ";
-			stream << page.second.title;
+			if (page.entryNumber)
+				stream << "#" << *page.entryNumber << u8" \u2014 ";
+			stream << page.title;
 			
 			menuItems->items.emplace_back(
 				MenuItem(
@@ -223,7 +278,7 @@ Menu::MenuItems *Menu::GetMenuItemsForBook(const Book &book) {
 					animate
 				)
 			);
-		} else if (page.second.type == Book::Page::Type::Foreward) {
+		} else if (page.type == Book::Page::Type::Foreward) {
 			menuItems->items.emplace_back(
 				MenuItem(
 					"Foreward",
@@ -266,19 +321,50 @@ void Menu::ScaleMenuItems() {
 	menuFont->SetScale(1.0f);
 	checkbox.SetSize(baseCheckBoxSize);
 
-	bool widthValid = false;
-	while (!widthValid) {
-		widthValid = true;
-		DoWithMenuItems([&](const OpenGLFont::FontGlyph &bounds, float accum, float xOffset, std::size_t i, const MenuItem &item) {
-			if (headerBounds.advance * 2 + bounds.advance * 4 + xOffset + bounds.w + (item.settingKey.empty() ? 0 : checkbox.GetSize() * 2) > engine->GetRenderer()->GetWidth()) {
-				menuFont->SetScale(menuFont->GetScale() - FontScaleDelta);
-				widthValid = false;
-				return false;
+	const auto width = engine->GetRenderer()->GetWidth();
+	auto key = TextFit::Key(width, engine->GetRenderer()->GetHeight(), currentMenuItems == &mainMenuItems, currentMenuItems == &settingsMenuItems);
+	if (currentMenuItems) {
+		for (const auto &item : currentMenuItems->items)
+			key = TextFit::Key(key, item.label, item.hint, item.image);
+	}
+
+	// Everything but the header's advance and the
+	// checkbox grows with the font
+	const auto fixed = [&](const MenuItem &item) {
+		return headerBounds.advance * 2 + (item.settingKey.empty() ? 0 : checkbox.GetSize() * 2);
+	};
+
+	// How far across each label reaches, margins included
+	const auto reach = [&](const ItemLayout &entry) {
+		return entry.right + entry.bounds.advance * 2.0f - headerBounds.advance;
+	};
+
+	menuFont->SetScale(textFit.Solve(
+		key,
+		[&] {
+			float estimate = 1.0f;
+			for (const auto &entry : BuildLayout()) {
+				const auto &item = currentMenuItems->items[entry.index];
+				if (!item.image.empty()) continue;
+
+				if (auto scaled = reach(entry); scaled > 0)
+					estimate = std::min(estimate, (width - fixed(item)) / scaled);
 			}
 
-			return true;
-		});
-	}
+			return estimate;
+		},
+		[&](float scale) {
+			menuFont->SetScale(scale);
+
+			const auto entries = BuildLayout();
+			return std::none_of(entries.begin(), entries.end(), [&](const auto &entry) {
+				const auto &item = currentMenuItems->items[entry.index];
+				return item.image.empty() && fixed(item) + reach(entry) > width;
+			});
+		}
+	));
+
+	UpdateLayout();
 }
 
 void Menu::Init() {
@@ -294,15 +380,8 @@ void Menu::Init() {
 
 	// Load background Chip
 	backgroundChip.relativePath = "Images/menuchip.png";
-	fpng::fpng_decode_file(
-		std::filesystem::absolute(FileRepository::registry->GetResourceDirectory() / backgroundChip.relativePath).string().c_str(),
-		backgroundChip.data,
-		backgroundChip.width,
-		backgroundChip.height,
-		backgroundChip.channels,
-		4
-	);
-	engine->GetRenderer()->LoadTexture(backgroundChip);
+	backgroundChip.Prepare(true);
+	engine->GetRenderer()->LoadAtlasTexture(backgroundChip);
 
 	// Find all books
 	auto bookPaths = FileRepository::fileRepository->GetFilesWithExtension(
@@ -310,46 +389,37 @@ void Menu::Init() {
 		".json"
 	);
 
-	// Try to soft load the books
-	for (const auto &path : bookPaths) {
-		auto book = Book(path, Book::LoadMode::Soft);
+	// Covers never need to be taller than the screen
+	uint32_t coverHeight = 0;
+	if (auto mode = glfwGetVideoMode(glfwGetPrimaryMonitor()))
+		coverHeight = static_cast<uint32_t>(mode->height);
+	catalog = std::make_shared<Catalog>(coverHeight ? coverHeight : 2160u);
+	catalog->Load();
+	catalog->Retain(bookPaths);
+
+	// Unchanged books come straight out of the catalog
+	std::vector<std::optional<Catalog::Entry>> entries(bookPaths.size());
+	WorkerPool::Shared().ParallelFor(bookPaths.size(), [&](std::size_t i) {
+		if (auto entry = catalog->Find(bookPaths[i]))
+			entries[i].emplace(std::move(*entry));
+	});
 
-		if (book.IsValid()
-#ifndef DEBUG
-			&& !book.IsTest()
-#endif
-			) {
-			books.emplace_back(
-				std::move(book)
-			);
+	for (const auto &[i, entry] : Enumerate(entries)) {
+		if (entry) {
+			AddBook(std::move(*entry));
+			continue;
 		}
-	}
 
-	// Preload book covers
-	for (const auto &book : books) {
-		if (const auto &front = book.GetFront(); !front.empty()) {
-			Book::Page::Image image;
-
-			image.relativePath = front;
-			fpng::fpng_decode_file(
-				std::filesystem::absolute(FileRepository::registry->GetResourceDirectory() / image.relativePath).string().c_str(),
-				image.data,
-				image.width,
-				image.height,
-				image.channels,
-				4
-			);
-			engine->GetRenderer()->LoadTexture(image);
-
-			covers.emplace(
-				std::make_pair(
-					front,
-					std::move(image)
-				)
-			);
-		}
+		// Soft load anything new or changed in the background
+		++pendingBooks;
+		WorkerPool::Shared().Submit([catalog = catalog, path = bookPaths[i]] {
+			catalog->Build(path);
+		});
 	}
 
+	if (!pendingBooks && catalog->IsDirty())
+		catalog->Save();
+
 	curl.Init();
 
 	// Load resolutions into resolution setting
@@ -395,9 +465,101 @@ void Menu::Init() {
 	return;
 }
 
-void Menu::Resize() {
-	SetCurrentMenuItems(currentMenuItems);
+bool Menu::AddBook(Catalog::Entry &&entry) {
+	auto &book = entry.book;
+
+	if (!book.IsValid()
+#ifndef DEBUG
+		|| book.IsTest()
+#endif
+		)
+		return false;
+
+	// Covers are replaced too, since a rebuilt entry means
+	// either the book or its cover changed
+	if (const auto &front = book.GetFront(); !front.empty() && entry.cover.HasPixels()) {
+		auto &cover = entry.cover;
+		engine->GetRenderer()->LoadTexture(cover);
+
+		// Match the scale Resize gives covers
+		cover.UpdateRatio();
+		cover.scaledHeight = engine->GetRenderer()->GetHeight() - headerBounds.h * 5.0f;
+		cover.scaledWidth = cover.scaledHeight * cover.ratio;
+
+		covers.insert_or_assign(front, std::move(cover));
+	}
+
+	// Replace books that were edited in place, so references
+	// held by menu items and selectedBook stay valid
+	const auto path = std::filesystem::absolute(book.GetPath()).lexically_normal();
+	for (auto &existing : books) {
+		if (std::filesystem::absolute(existing.GetPath()).lexically_normal() == path) {
+			existing = std::move(book);
+			return true;
+		}
+	}
+
+	books.emplace_back(
+		std::move(book)
+	);
+
+	return false;
+}
+
+void Menu::UpdateLibrary() {
+	// Books can't be swapped out from under an animation
+	if (!pendingBooks || animationState != AnimationState::None) return;
+
+	auto entries = catalog->TakeBuilt();
+	if (entries.empty()) return;
+
+	bool replaced = false;
+	pendingBooks -= entries.size();
+	for (auto &entry : entries)
+		replaced |= AddBook(std::move(entry));
+
+	if (!pendingBooks)
+		WorkerPool::Shared().Submit([catalog = catalog] {
+			catalog->Save();
+		});
+
+	// Rebuild the book list if it's showing. A replaced book's
+	// page list refers to its old pages, so that goes back to
+	// the book list as well.
+	if (currentMenuItems && (currentMenuItems == shownBookMenuItems || (replaced && currentMenuItems != &mainMenuItems && currentMenuItems != &settingsMenuItems)))
+		SetCurrentMenuItems(GetBookMenuItems());
+}
+
+void Menu::OnFilesChanged(const std::vector<std::filesystem::path> &paths) {
+	const auto resourceDirectory = std::filesystem::absolute(FileRepository::registry->GetResourceDirectory()).lexically_normal();
+	const auto booksDirectory = resourceDirectory / "Books";
+
+	std::set<std::filesystem::path> rebuild;
+	for (const auto &path : paths) {
+		bool isBook = path.parent_path() == booksDirectory && path.extension() == ".json";
+		if (isBook)
+			rebuild.emplace(path);
+
+		// Use the path the catalog knows existing books by, and
+		// rebuild books whose cover changed
+		for (const auto &book : books) {
+			if ((isBook && std::filesystem::absolute(book.GetPath()).lexically_normal() == path) ||
+				(!book.GetFront().empty() && (resourceDirectory / book.GetFront()).lexically_normal() == path)) {
+				rebuild.erase(path);
+				rebuild.emplace(book.GetPath());
+			}
+		}
+	}
+
+	for (const auto &path : rebuild) {
+		++pendingBooks;
+		WorkerPool::Shared().Submit([catalog = catalog, path] {
+			catalog->Build(path);
+		});
+	}
+}
 
+void Menu::Resize() {
 	// Update aspect ratios for covers
 	for (auto &cover : covers) {
 		cover.second.UpdateRatio();
@@ -405,6 +567,9 @@ void Menu::Resize() {
 		cover.second.scaledWidth = cover.second.scaledHeight * cover.second.ratio;
 	}
 
+	// Lay out again with the covers at their new size
+	SetCurrentMenuItems(currentMenuItems);
+
 	curl.Resize(
 		engine->GetRenderer()->GetBackground().scaledWidth / 2.0f,
 		engine->GetRenderer()->GetBackground().scaledHeight
@@ -423,159 +588,207 @@ void Menu::Resize() {
 	backgroundChip.Scale(engine->GetRenderer()->GetWidth() / 2.0f, engine->GetRenderer()->GetHeight() - headerBounds.h);
 }
 
-void Menu::DoWithMenuItems(std::function<bool(const OpenGLFont::FontGlyph &, float, float, std::size_t, const MenuItem &)> f) {
-	float accum = headerBounds.h * (currentMenuItems == &mainMenuItems ? 3.0f : 2.5f);
+std::vector<Menu::ItemLayout> Menu::BuildLayout() {
+	std::vector<ItemLayout> entries;
+	if (!currentMenuItems) return entries;
+
+	const auto height = engine->GetRenderer()->GetHeight();
+	const auto main = currentMenuItems == &mainMenuItems;
+	float accum = headerBounds.h * (main ? 3.0f : 2.5f);
 	float xOffset = 0.0f;
 	int maxWidth = std::numeric_limits<int>::min();
 
-	if (currentMenuItems) {
-		for (const auto &[i, item] : Enumerate(currentMenuItems->items)) {
-			if (item.image.empty()) {
-				auto bounds = menuFont->GetBoundsForString(item.label);
-				auto hintBounds = 
-					item.hint.empty() ? std::optional<OpenGLFont::FontGlyph>(std::nullopt) : bounds = menuFont->GetBoundsForString(item.hint);
-
-				maxWidth = std::max(bounds.w, maxWidth);
-
-				if (!f(hintBounds && hintBounds->w > bounds.w ? *hintBounds : bounds, accum, xOffset, i, item))
-					break;
-
-				if (!item.hint.empty()) {
-					menuFont->Draw(
-						item.hint,
-						headerBounds.advance + hintBounds->advance * 2.0f + xOffset,
-						accum + bounds.h,
-						OpenGLFont::FontMargin::FONT_MARGIN_FULL_CHAR,
-						OpenGLFont::FontMargin::FONT_MARGIN_NONE
-					);
-					maxWidth = std::max(bounds.w + bounds.advance, maxWidth);
-				}
+	entries.reserve(currentMenuItems->items.size());
+	for (const auto &[i, item] : Enumerate(currentMenuItems->items)) {
+		auto &entry = entries.emplace_back();
+		entry.index = i;
+
+		if (item.image.empty()) {
+			// Items with a hint are measured by it
+			auto bounds = menuFont->GetBoundsForString(item.hint.empty() ? item.label : item.hint);
+
+			const auto margin = main ? bounds.h * 0.25f : 0.0f;
+			entry.bounds = bounds;
+			entry.x = headerBounds.advance + bounds.advance * 2.0f + xOffset;
+			entry.y = accum;
+			entry.left = entry.x;
+			entry.top = accum - margin;
+			entry.right = entry.x + bounds.w;
+			entry.bottom = accum + bounds.h * (item.hint.empty() ? 1.0f : 2.5f) + margin;
+
+			maxWidth = std::max(bounds.w, maxWidth);
+			if (!item.hint.empty())
+				maxWidth = std::max(bounds.w + bounds.advance, maxWidth);
+
+			accum += bounds.h * 2.5f;
+
+			if (currentMenuItems != &settingsMenuItems && accum >= height - headerBounds.h * 2.5f) {
+				accum = headerBounds.h * 2.5f;
+				xOffset += maxWidth + bounds.advance * 2.0f;
+				maxWidth = std::numeric_limits<int>::min();
+			}
+		} else {
+			const auto &cover = covers[item.image];
+
+			entry.scrolls = true;
+			entry.x = headerBounds.advance + xOffset;
+			entry.y = accum;
+			entry.left = entry.x;
+			entry.top = accum;
+			entry.right = entry.x + cover.scaledWidth;
+			entry.bottom = accum + cover.scaledHeight;
+
+			xOffset += cover.scaledWidth * 1.25f;
+			if (i == currentMenuItems->items.size() - 2) {
+				// Generate the scrollbar vertex buffer
+				totalWidth = xOffset;
+
+				// Hide scrollbar if it's not needed
+				if (totalWidth <= engine->GetRenderer()->GetWidth())
+					scrollBarActive = false;
+
+				scrollBarVertexBuffer[4] = scrollBarVertexBuffer[6] = (engine->GetRenderer()->GetWidth() / totalWidth) * engine->GetRenderer()->GetWidth();
+
+				xOffset = 0.0f;
+				accum += cover.scaledHeight + menuFont->GetBoundsForString(back).h;
+				scrollBarYPos = accum;
+				accum += 30.0f;
+			}
+		}
+	}
 
-				accum += bounds.h * 2.5f;
+	// Checkboxes and values go in a column after the labels
+	if (currentMenuItems == &settingsMenuItems) {
+		accum = headerBounds.h * 2.5f;
+		for (auto &entry : entries) {
+			const auto &item = currentMenuItems->items[entry.index];
+			if (item.settingKey.empty()) continue;
+
+			auto bounds = menuFont->GetBoundsForString(item.label);
+			entry.control = std::make_pair(
+				maxWidth + headerBounds.advance + bounds.advance * 2.0f + xOffset + checkbox.GetSize(),
+				accum + bounds.h / 2.0f
+			);
 
-				if (currentMenuItems != &settingsMenuItems && accum >= engine->GetRenderer()->GetHeight() - headerBounds.h * 2.5f) {
-					accum = headerBounds.h * 2.5f;
-					xOffset += maxWidth + bounds.advance * 2.0f;
-					maxWidth = std::numeric_limits<int>::min();
-				}
-			} else {
-				const auto &cover = covers[item.image];
-				const auto viewport = (scrollbarXPos / engine->GetRenderer()->GetWidth() * totalWidth);
+			accum += bounds.h * 2.5f;
 
-				glTranslatef(
-					headerBounds.advance + xOffset - viewport,
-					accum,
-					0.0f
-				);
-
-				// Is our mouse hovered over this item?
-				if (auto pos = engine->GetManager()->GetMousePos();
-					pos.first >= headerBounds.advance + xOffset - viewport &&
-					pos.first <= headerBounds.advance + xOffset - viewport + cover.scaledWidth &&
-					pos.second >= accum &&
-					pos.second <= accum + cover.scaledHeight &&
-					!draggingScrollbar) {
-					glColor4f(Color::ChipPink.r, Color::ChipPink.g, Color::ChipPink.b, 1.0f);
-					hoveredIndex = i;
-				} else {
-					glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
-				}
+			if (accum >= height - headerBounds.h * 2.5f) {
+				accum = headerBounds.h * 2.5f;
+				xOffset += maxWidth + bounds.advance * 2.0f;
+				maxWidth = std::numeric_limits<int>::min();
+			}
+		}
+	}
 
-				engine->GetRenderer()->RenderTexture(cover, nullptr, Renderer::GetTextureBuffer(), true);
+	return entries;
+}
 
-				xOffset += cover.scaledWidth * 1.25f;
-				if (i == currentMenuItems->items.size() - 2) {
-					// Generate the scrollbar vertex buffer
-					totalWidth = xOffset;
+void Menu::UpdateLayout() {
+	layout = BuildLayout();
 
-					// Hide scrollbar if it's not needed
-					if (totalWidth <= engine->GetRenderer()->GetWidth())
-						scrollBarActive = false;
+	// Size the grid to everything laid out, covers scrolled
+	// all the way back included
+	float right = 0.0f, bottom = 0.0f;
+	for (const auto &entry : layout) {
+		right = std::max(right, entry.right);
+		bottom = std::max(bottom, entry.bottom);
+	}
 
-					scrollBarVertexBuffer[4] = scrollBarVertexBuffer[6] = (engine->GetRenderer()->GetWidth() / totalWidth) * engine->GetRenderer()->GetWidth();
+	gridColumns = static_cast<std::size_t>(std::max(right, 0.0f) / GridCell) + 1;
+	gridRows = static_cast<std::size_t>(std::max(bottom, 0.0f) / GridCell) + 1;
+	grid.assign(gridColumns * gridRows, {});
 
-					xOffset = 0.0f;
-					accum += cover.scaledHeight + menuFont->GetBoundsForString(back).h;
-					scrollBarYPos = accum;
-					accum += 30.0f;
-				}
-			}
-		}
+	for (const auto &[i, entry] : Enumerate(layout)) {
+		auto [left, top] = GetGridCell(entry.left, entry.top);
+		auto [right, bottom] = GetGridCell(entry.right, entry.bottom);
 
-		// Draw checkboxes if we're in settings
-		if (currentMenuItems == &settingsMenuItems) {
-			accum = headerBounds.h * 2.5f;
-			for (const auto &[i, item] : Enumerate(currentMenuItems->items)) {
-				if (!item.settingKey.empty()) {
-					auto bounds = menuFont->GetBoundsForString(item.label);
-
-					if (item.settingValues.empty()) {
-						checkbox.Draw(
-							maxWidth + headerBounds.advance + bounds.advance * 2.0f + xOffset + checkbox.GetSize(),
-							accum + bounds.h / 2.0f, item.value > 0
-						);
-					} else {
-						menuFont->SetColor(Color::ChipTan);
-						menuFont->Draw(
-							item.settingValues[item.value],
-							maxWidth + headerBounds.advance + bounds.advance * 2.0f + xOffset + checkbox.GetSize(),
-							accum + bounds.h / 2.0f,
-							OpenGLFont::FontMargin::FONT_MARGIN_NONE,
-							OpenGLFont::FontMargin::FONT_MARGIN_NONE
-						);
-					}
-
-					accum += bounds.h * 2.5f;
-
-					if (accum >= engine->GetRenderer()->GetHeight() - headerBounds.h * 2.5f) {
-						accum = headerBounds.h * 2.5f;
-						xOffset += maxWidth + bounds.advance * 2.0f;
-						maxWidth = std::numeric_limits<int>::min();
-					}
-				}
-			}
+		for (auto y = top; y <= bottom; ++y) {
+			for (auto x = left; x <= right; ++x)
+				grid[y * gridColumns + x].emplace_back(i);
 		}
 	}
 }
 
+std::pair<std::size_t, std::size_t> Menu::GetGridCell(float x, float y) const {
+	return std::make_pair(
+		std::min(static_cast<std::size_t>(std::max(x, 0.0f) / GridCell), gridColumns - 1),
+		std::min(static_cast<std::size_t>(std::max(y, 0.0f) / GridCell), gridRows - 1)
+	);
+}
+
+std::optional<std::size_t> Menu::HitTest(float x, float y) const {
+	if (grid.empty()) return std::nullopt;
+
+	std::optional<std::size_t> hit;
+	const auto test = [&](float x, float y, bool scrolls) {
+		// Points off the grid land in its edge cells, whose
+		// items are still checked against their own bounds
+		auto [column, row] = GetGridCell(x, y);
+		for (auto i : grid[row * gridColumns + column]) {
+			const auto &entry = layout[i];
+			if (entry.scrolls != scrolls) continue;
+
+			if (x >= entry.left && x <= entry.right && y >= entry.top && y <= entry.bottom)
+				hit = std::max(hit.value_or(entry.index), entry.index);
+		}
+	};
+
+	// Covers can't be picked while scrolling, text can't
+	// during a transition
+	if (animationState == AnimationState::None)
+		test(x, y, false);
+	if (!draggingScrollbar)
+		test(x + scrollbarXPos / engine->GetRenderer()->GetWidth() * totalWidth, y, true);
+
+	return hit;
+}
+
 void Menu::Render() {
+	auto &sprites = engine->GetRenderer()->GetSprites();
+
+	UpdateLibrary();
+
+	// Books still being read in or a transition under way
+	if (pendingBooks || animationState != AnimationState::None)
+		engine->GetRenderer()->Invalidate();
+
 	auto fontAlpha = (
 		animationState == AnimationState::None ?
 			1.0f :
 			(
 				animationState == AnimationState::Fade ?
-				1.0f - ease->Advance(engine->GetManager()->GetDeltaTime()) :
+				1.0f - engine->GetRenderer()->GetTimeline().Value(ease).value_or(1.0f) :
 				0.0f
 			)
 	);
 
 	// Render background
 	if (animationState < AnimationState::In) {
-		glColor4f(Color::ChipTan.r, Color::ChipTan.g, Color::ChipTan.b, fontAlpha);
+		sprites.SetColor(Color::ChipTan.r, Color::ChipTan.g, Color::ChipTan.b, fontAlpha);
 		glVertexPointer(2, GL_FLOAT, 0, backgroundRectVertexBuffer);
 		glEnableClientState(GL_VERTEX_ARRAY);
 		glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, engine->GetRenderer()->GetIndexBuffer());
-		glColor4f(Color::ChipRed.r, Color::ChipRed.g, Color::ChipRed.b, fontAlpha);
+		sprites.SetColor(Color::ChipRed.r, Color::ChipRed.g, Color::ChipRed.b, fontAlpha);
 		float scaleX = 1.0f - (static_cast<float>(headerBounds.advance) / engine->GetRenderer()->GetWidth());
 		float scaleY = 1.0f - (static_cast<float>(headerBounds.h) / engine->GetRenderer()->GetHeight());
-		glTranslatef(headerBounds.advance / 2.0f, headerBounds.h / 2.0f, 0.0f);
-		glScalef(scaleX, scaleY, 1.0f);
+		sprites.Translate(headerBounds.advance / 2.0f, headerBounds.h / 2.0f, 0.0f);
+		sprites.Scale(scaleX, scaleY, 1.0f);
 		glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, engine->GetRenderer()->GetIndexBuffer());
 		glDisableClientState(GL_VERTEX_ARRAY);
-		glLoadIdentity();
+		sprites.LoadIdentity();
 
 		// Fill bottom right corner of screen with background Chip
-		glTranslatef(
+		sprites.Translate(
 			engine->GetRenderer()->GetWidth() - backgroundChip.scaledWidth - headerBounds.advance,
 			engine->GetRenderer()->GetHeight() - backgroundChip.scaledHeight - headerBounds.h / 2.0f,
 			0.0f
 		);
-		glColor4f(1.0f, 1.0f, 1.0f, fontAlpha);
+		sprites.SetColor(1.0f, 1.0f, 1.0f, fontAlpha);
 		engine->GetRenderer()->RenderTexture(backgroundChip, nullptr, engine->GetRenderer()->GetTextureBuffer(), true);
 
 		// If we're not in the main menu, dim background
 		if (currentMenuItems != &mainMenuItems) {
-			glColor4f(0.0f, 0.0f, 0.0f, 0.5f);
+			sprites.SetColor(0.0f, 0.0f, 0.0f, 0.5f);
 			glVertexPointer(2, GL_FLOAT, 0, backgroundRectVertexBuffer);
 			glEnableClientState(GL_VERTEX_ARRAY);
 			glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, engine->GetRenderer()->GetIndexBuffer());
@@ -593,16 +806,26 @@ void Menu::Render() {
 
 	auto pos = engine->GetManager()->GetMousePos();
 
-	hoveredIndex = std::nullopt;
-	DoWithMenuItems([&] (const OpenGLFont::FontGlyph &bounds, float accum, float xOffset, std::size_t i, const MenuItem &item) {
-		// Is our mouse hovered over this item?
+	hoveredIndex = HitTest(static_cast<float>(pos.first), static_cast<float>(pos.second));
+	for (const auto &entry : layout) {
+		const auto &item = currentMenuItems->items[entry.index];
+		const bool hovered = hoveredIndex == entry.index;
+
+		if (!item.image.empty()) {
+			sprites.Translate(entry.x - scrollbarXPos / engine->GetRenderer()->GetWidth() * totalWidth, entry.y, 0.0f);
+
+			if (hovered)
+				sprites.SetColor(Color::ChipPink.r, Color::ChipPink.g, Color::ChipPink.b, 1.0f);
+			else
+				sprites.SetColor(1.0f, 1.0f, 1.0f, 1.0f);
+
+			engine->GetRenderer()->RenderTexture(covers[item.image], nullptr, Renderer::GetTextureBuffer(), true);
+			continue;
+		}
+
 		float yOffset = 0.0f;
 		OpenGLFont::FontGlyph newBounds;
-		if (pos.first >= headerBounds.advance + bounds.advance * 2.0f + xOffset &&
-			pos.first <= headerBounds.advance + bounds.advance * 2.0f + xOffset + bounds.w &&
-			pos.second >= accum - (currentMenuItems == &mainMenuItems ? bounds.h * 0.25f : 0) &&
-			pos.second <= accum + bounds.h * (item.hint.empty() ? 1.0f : 2.5f) + (currentMenuItems == &mainMenuItems ? bounds.h * 0.25f : 0) &&
-			animationState == AnimationState::None) {
+		if (hovered) {
 			if (currentMenuItems != &mainMenuItems) {
 				menuFont->SetColor(Color::ChipRed);
 				menuFont->SetStyle({
@@ -614,16 +837,15 @@ void Menu::Render() {
 				});
 			}
 			newBounds = menuFont->GetBoundsForString(item.label);
-			yOffset = (bounds.h - newBounds.h) / 2.0f;
-			hoveredIndex = i;
+			yOffset = (entry.bounds.h - newBounds.h) / 2.0f;
 		} else {
 			menuFont->SetColor(Color::ChipTan);
 		}
 
 		menuFont->Draw(
 			item.label,
-			headerBounds.advance + bounds.advance * 2 + xOffset,
-			accum + yOffset - (currentMenuItems == &mainMenuItems ? newBounds.h / 4.0f : 0),
+			entry.x,
+			entry.y + yOffset - (currentMenuItems == &mainMenuItems ? newBounds.h / 4.0f : 0),
 			fontAlpha,
 			OpenGLFont::FontMargin::FONT_MARGIN_NONE,
 			OpenGLFont::FontMargin::FONT_MARGIN_NONE
@@ -631,8 +853,36 @@ void Menu::Render() {
 
 		menuFont->ClearSpan();
 
-		return true;
-	});
+		if (!item.hint.empty()) {
+			menuFont->Draw(
+				item.hint,
+				entry.x,
+				entry.y + entry.bounds.h,
+				OpenGLFont::FontMargin::FONT_MARGIN_FULL_CHAR,
+				OpenGLFont::FontMargin::FONT_MARGIN_NONE
+			);
+		}
+	}
+
+	// Checkboxes and values for settings
+	for (const auto &entry : layout) {
+		if (!entry.control) continue;
+
+		const auto &item = currentMenuItems->items[entry.index];
+		auto [x, y] = *entry.control;
+		if (item.settingValues.empty()) {
+			checkbox.Draw(x, y, item.value > 0);
+		} else {
+			menuFont->SetColor(Color::ChipTan);
+			menuFont->Draw(
+				item.settingValues[item.value],
+				x,
+				y,
+				OpenGLFont::FontMargin::FONT_MARGIN_NONE,
+				OpenGLFont::FontMargin::FONT_MARGIN_NONE
+			);
+		}
+	}
 
 	if (animationState >= AnimationState::In && animationState <= AnimationState::Move && selectedBook && !selectedBook->get().GetFront().empty()) {
 		auto &cover = covers[selectedBook->get().GetFront()];
@@ -642,15 +892,16 @@ void Menu::Render() {
 			engine->GetRenderer()->GetHeight()
 		);
 
+		auto value = engine->GetRenderer()->GetTimeline().Value(ease).value_or(1.0f);
 		if (animationState == AnimationState::In) {
-			cover.scaledWidth *= ease->Advance(engine->GetManager()->GetDeltaTime());
-			cover.scaledHeight *= ease->Value();
+			cover.scaledWidth *= value;
+			cover.scaledHeight *= value;
 		}
 		
-		glTranslatef(
+		sprites.Translate(
 			engine->GetRenderer()->GetWidth() / 2.0f - cover.scaledWidth / 2.0f + (
 				animationState == AnimationState::Move ?
-				ease->Advance(engine->GetManager()->GetDeltaTime()) * cover.scaledWidth / 2.0f :
+				value * cover.scaledWidth / 2.0f :
 				(
 					animationState > AnimationState::Move ?
 					cover.scaledWidth / 2.0f :
@@ -661,13 +912,13 @@ void Menu::Render() {
 			0.0f
 		);
 
-		glColor4f(1.0f, 1.0f, 1.0f, animationState == AnimationState::In ? ease->Value() : 1.0f);
+		sprites.SetColor(1.0f, 1.0f, 1.0f, animationState == AnimationState::In ? value : 1.0f);
 		engine->GetRenderer()->RenderTexture(cover, nullptr, Renderer::GetTextureBuffer(), true);
 	}
 
 	if (animationState == AnimationState::Open) {
 		// Render the right half of the first page's texture under the curl
-		glTranslatef(engine->GetRenderer()->GetWidth() / 2.0f, 0.0f, 0.0f);
+		sprites.Translate(engine->GetRenderer()->GetWidth() / 2.0f, 0.0f, 0.0f);
 		engine->GetRenderer()->RenderTexture(
 			engine->GetRenderer()->GetForewardBackground(),
 			halfVertexBuffer,
@@ -680,14 +931,14 @@ void Menu::Render() {
 				engine->GetRenderer()->GetWidth() / 2.0f,
 				0.0f,
 				halfVertexBuffer,
-				engine->GetRenderer()->GetCurlRenderCallback(engine->GetRenderer()->GetTextureBuffer()),
 				engine->GetManager()->GetDeltaTime(),
+				engine->GetRenderer()->GetTextureBuffer(),
 				std::nullopt,
 				true,
 				selectedPage == 0
 			);
 		} else {
-			glTranslatef(engine->GetRenderer()->GetWidth() / 2.0f - engine->GetRenderer()->GetForewardBackground().scaledWidth / 2.0f, 0.0f, 0.0f);
+			sprites.Translate(engine->GetRenderer()->GetWidth() / 2.0f - engine->GetRenderer()->GetForewardBackground().scaledWidth / 2.0f, 0.0f, 0.0f);
 			engine->GetRenderer()->RenderTexture(
 				selectedPage == 0 ? engine->GetRenderer()->GetForewardBackground() : engine->GetRenderer()->GetBackground(),
 				halfVertexBuffer,
@@ -696,32 +947,6 @@ void Menu::Render() {
 		}
 	}
 
-	if (animationState != AnimationState::None && ease && ease->Value() >= ease->End()) {
-		++animationState;
-
-		ease = std::make_unique<Ease<float>>(0.0f, 1.0f, 1.0f);
-		if (animationState == AnimationState::Open) {
-			curl.Start(Curl::CurlDir::Right, [&] {
-				// TODO: Load book in separate thread while animation plays
-				if (auto currentBook = engine->GetBook(); currentBook && currentBook->GetTitle() == selectedBook->get().GetTitle()) {
-					ease.reset();
-					animationState = AnimationState::None;
-
-					// Resize to reset the scale of the book covers
-					Resize();
-
-					engine->GetRenderer()->SetPage(selectedPage);
-					engine->SetState(Engine::State::Book);
-				} else {
-					if (!loaded)
-						engine->SetState(Engine::State::Loading);
-
-					loadingMutex.unlock();
-				}
-			});
-		}
-	}
-
 	// Render scrollbar
 
 	if (!scrollBarActive) return;
@@ -732,7 +957,7 @@ void Menu::Render() {
 		pos.second >= scrollBarYPos &&
 		pos.second <= scrollBarYPos + scrollBarVertexBuffer[3])) {
 		hoveredOverScrollbar = true;
-		glColor4f(Color::ChipPink.r, Color::ChipPink.g, Color::ChipPink.b, Color::ChipPink.a);
+		sprites.SetColor(Color::ChipPink.r, Color::ChipPink.g, Color::ChipPink.b, Color::ChipPink.a);
 		
 		if (draggingScrollbar) {
 			scrollbarXPos = std::clamp(
@@ -743,17 +968,17 @@ void Menu::Render() {
 		}
 	} else {
 		hoveredOverScrollbar = false;
-		glColor4f(Color::ChipRed.r, Color::ChipRed.g, Color::ChipRed.b, Color::ChipRed.a);
+		sprites.SetColor(Color::ChipRed.r, Color::ChipRed.g, Color::ChipRed.b, Color::ChipRed.a);
 	}
 
-	glTranslatef(scrollbarXPos, scrollBarYPos, 0.0f);
+	sprites.Translate(scrollbarXPos, scrollBarYPos, 0.0f);
 	glVertexPointer(2, GL_FLOAT, 0, scrollBarVertexBuffer);
 	glEnableClientState(GL_VERTEX_ARRAY);
 	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, engine->GetRenderer()->GetIndexBuffer());
 	glDisableClientState(GL_VERTEX_ARRAY);
 
 	glDisable(GL_TEXTURE_2D);
-	glLoadIdentity();
+	sprites.LoadIdentity();
 }
 
 void Menu::OnClick(int action) {
@@ -790,9 +1015,38 @@ void Menu::Back() {
 
 void Menu::Show() {
 	animationState = AnimationState::None;
+	engine->GetRenderer()->GetTimeline().Stop(ease);
+}
+
+void Menu::NextAnimation() {
+	++animationState;
+
+	if (animationState < AnimationState::Open) {
+		ease = engine->GetRenderer()->GetTimeline().Start(0.0f, 1.0f, 1.0f, [this] { NextAnimation(); });
+		return;
+	}
+
+	curl.Start(Curl::CurlDir::Right, [&] {
+		// TODO: Load book in separate thread while animation plays
+		if (auto currentBook = engine->GetBook(); currentBook && currentBook->GetTitle() == selectedBook->get().GetTitle()) {
+			animationState = AnimationState::None;
+
+			// Resize to reset the scale of the book covers
+			Resize();
+
+			engine->GetRenderer()->SetPage(selectedPage);
+			engine->SetState(Engine::State::Book);
+		} else {
+			if (!loaded)
+				engine->SetState(Engine::State::Loading);
+
+			loadingMutex.unlock();
+		}
+	});
 }
 
 void Menu::Cleanup() {
 	headerFont->KillFont();
 	menuFont->KillFont();
+	curl.Cleanup();
 }
\ No newline at end of file
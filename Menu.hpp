@@ -1,13 +1,16 @@
 #pragma once
 
+#include <deque>
 #include <mutex>
 
 #include "Rendering/Checkbox.hpp"
 #include "Rendering/OpenGLFont.hpp"
 
 #include "Book.hpp"
+#include "Catalog.hpp"
 #include "Curl.hpp"
-#include "Ease.hpp"
+#include "TextFit.hpp"
+#include "Timeline.hpp"
 
 using namespace SnobasteCPP;
 
@@ -60,6 +63,9 @@ public:
 
 	void OnClick(int action);
 
+	// Re-indexes books whose source or cover changed on disk
+	void OnFilesChanged(const std::vector<std::filesystem::path> &paths);
+
 	void Back();
 
 	void Show();
@@ -115,13 +121,47 @@ private:
 		}
 	};
 
+	// Where one of the current items goes, at the current
+	// font scale and window size
+	struct ItemLayout {
+		std::size_t index = 0;
+
+		// Drawn from x, y, hovered anywhere in left, top,
+		// right, bottom. Covers scroll, text doesn't.
+		float x = 0.0f, y = 0.0f;
+		float left = 0.0f, top = 0.0f, right = 0.0f, bottom = 0.0f;
+		bool scrolls = false;
+
+		// The label's, or the hint's if it has one
+		OpenGLFont::FontGlyph bounds;
+
+		// Settings' checkbox or value
+		std::optional<std::pair<float, float>> control;
+	};
+
+	// Side of a hit-test grid cell, in pixels
+	static constexpr float GridCell = 64.0f;
+
 	void SetCurrentMenuItems(MenuItems *menuItems);
-	void DoWithMenuItems(std::function<bool(const OpenGLFont::FontGlyph &, float, float, std::size_t, const MenuItem &)> f);
+	// Lays the current items out, measuring without drawing
+	std::vector<ItemLayout> BuildLayout();
+	// Fits the font to the current items, then lays
+	// them out for drawing and hovering
 	void ScaleMenuItems();
+	void UpdateLayout();
+
+	std::pair<std::size_t, std::size_t> GetGridCell(float x, float y) const;
+	// The item under a point, the last laid out if several are
+	std::optional<std::size_t> HitTest(float x, float y) const;
 
 	MenuItems *GetBookMenuItems();
 	MenuItems *GetMenuItemsForBook(const Book &book);
 
+	// Adds a catalog entry to the library, uploading its cover.
+	// Returns true if it replaced a book already listed.
+	bool AddBook(Catalog::Entry &&entry);
+	void UpdateLibrary();
+
 	Engine *engine = nullptr;
 
 	std::unique_ptr<OpenGLFont> headerFont;
@@ -132,19 +172,38 @@ private:
 	MenuItems mainMenuItems;
 	MenuItems settingsMenuItems;
 	MenuItems *currentMenuItems = nullptr;
+	MenuItems *shownBookMenuItems = nullptr;
 
 	std::optional<std::size_t> hoveredIndex = std::nullopt;
 
-	std::vector<Book> books;
+	// Only rebuilt by SetCurrentMenuItems, which Resize goes through
+	std::vector<ItemLayout> layout;
+	// Indices into layout for every cell an item touches
+	std::vector<std::vector<std::size_t>> grid;
+	std::size_t gridColumns = 0;
+	std::size_t gridRows = 0;
+
+	// Deque so menu items can keep references to books
+	// while new ones arrive from the catalog
+	std::deque<Book> books;
+
+	// Shared with the worker pool jobs re-indexing books
+	std::shared_ptr<Catalog> catalog;
+	std::size_t pendingBooks = 0;
 
 	OpenGLFont::FontGlyph headerBounds;
 
+	// Menu font scales for each set of items and window size
+	TextFit textFit;
+
 	const std::string back;
 
 	std::map<std::string, Book::Page::Image> covers;
 
 	AnimationState animationState = AnimationState::None;
-	std::unique_ptr<Ease<float>> ease;
+	Timeline::Handle ease;
+	// Moves on to the next state once the current one's tween ends
+	void NextAnimation();
 	std::optional<std::reference_wrapper<const Book>> selectedBook;
 	std::size_t selectedPage;
 
@@ -0,0 +1,168 @@
+#include "PageLayout.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+#include "Utils/Enumerate.hpp"
+
+PageLayout PageLayout::Build(const Book::Page &page, const Box &box, OpenGLFont &headerFont, OpenGLFont *font, const std::map<uint32_t, OpenGLFont::SpanItem> &spans, TextFit &fit) {
+	PageLayout layout;
+	layout.box = box;
+
+	const float width = box.width / 2.0f - box.margin * 2;
+
+	// Does this page start an entry?
+	// If so, fit its header to the page
+	if (!page.title.empty()) {
+		std::stringstream header;
+		if (page.entryNumber)
+			header << "#" << *page.entryNumber << u8" \u2014 ";
+		header << page.title;
+
+		const auto size = header.str().size();
+		const auto titleStyle = page.titleStyle.empty() ? OpenGLFont::Style::BoldItalic : page.style;
+		layout.headerSpan = {
+			{ 0, { size - 2 - page.title.size(), OpenGLFont::Style::BoldItalic }},
+			{ size - 2 - page.title.size(), { size - 3, titleStyle }}
+		};
+
+		header << " (" << page.date << ")";
+		layout.header = header.str();
+
+		headerFont.SetSpan(layout.headerSpan);
+		layout.headerScale = fit.Solve(
+			TextFit::Key(layout.header, width, static_cast<const void *>(&headerFont), page.title.size(), static_cast<int>(titleStyle)),
+			[&] {
+				headerFont.SetScale(1.0f);
+				auto bounds = headerFont.GetBoundsForString(layout.header);
+				return bounds.w > 0 ? width / bounds.w : 1.0f;
+			},
+			[&](float scale) {
+				headerFont.SetScale(scale);
+				return headerFont.GetBoundsForString(layout.header).w <= width;
+			}
+		);
+		headerFont.SetScale(layout.headerScale);
+		layout.headerBounds = headerFont.GetBoundsForString(layout.header);
+		headerFont.ClearSpan();
+	} else {
+		// Leave the room an unscaled header would take, so
+		// text lines up with the facing page
+		headerFont.SetScale(1.0f);
+		layout.headerBounds = headerFont.GetBoundsForString("()");
+	}
+
+	layout.paragraphs.assign(page.paragraphs.begin(), page.paragraphs.end());
+	layout.paragraphBounds.resize(layout.paragraphs.size());
+	if (!font || layout.paragraphs.empty()) return layout;
+
+	// Load each paragraph's span
+	for (const auto &[i, paragraph] : Enumerate(page.paragraphs)) {
+		if (auto runs = page.GetRuns(i); !runs.empty()) {
+			OpenGLFont::Span span;
+
+			for (const auto &run : runs) {
+				span.emplace(
+					std::make_pair(
+						static_cast<std::size_t>(run.begin),
+						std::make_pair(
+							static_cast<std::size_t>(run.end),
+							spans.at(run.style)
+						)
+					)
+				);
+			}
+
+			layout.paragraphSpans.emplace(
+				std::make_pair(
+					i,
+					span
+				)
+			);
+		}
+	}
+
+	const float height = box.height - box.margin * 4.0f - layout.headerBounds.h * 2;
+	const bool wrap = page.type == Book::Page::Type::Story || page.type == Book::Page::Type::Foreward;
+
+	// Wraps and measures every paragraph at scale, as they
+	// will be drawn
+	float measured = 0.0f;
+	const auto measure = [&](float scale) {
+		measured = scale;
+		font->SetScale(scale);
+
+		if (wrap) {
+			for (const auto &[i, source] : Enumerate(page.paragraphs)) {
+				auto copy = StringUtils::ReplaceAll(std::string(source), "\n", " ");
+				auto &paragraph = layout.paragraphs[i];
+				paragraph.clear();
+				Rectangle<int> rect = {
+					0,
+					0,
+					static_cast<int>(width),
+					static_cast<int>(height)
+				};
+
+				font->Wrap(
+					copy,
+					rect,
+					rect,
+					[&](std::string_view line, int y, bool hyphenate) {
+						auto string = std::string(line.data(), line.size());
+						if (hyphenate) string.push_back('-');
+						else string.push_back('\n');
+
+						paragraph.append(string);
+						return font->GetBounds(line).h;
+					}
+				);
+			}
+		}
+
+		layout.bounds = OpenGLFont::FontGlyph();
+		for (const auto &[i, paragraph] : Enumerate(layout.paragraphs)) {
+			if (auto iter = layout.paragraphSpans.find(i); iter != layout.paragraphSpans.end())
+				font->SetSpan(iter->second);
+
+			auto &bounds = layout.paragraphBounds[i] = font->GetBoundsForString(paragraph);
+			layout.bounds.w = std::max(layout.bounds.w, bounds.w);
+			layout.bounds.h += bounds.h;
+			font->ClearSpan();
+		}
+
+		return (page.type != Book::Page::Type::Poem || layout.bounds.w <= width) && layout.bounds.h <= height;
+	};
+
+	// Runs are keyed by their span's hash, so they
+	// stand in for the styles they pick
+	auto key = TextFit::Key(static_cast<const void *>(font), page.font, static_cast<int>(page.type), width, height);
+	for (const auto &[i, paragraph] : Enumerate(page.paragraphs)) {
+		key = TextFit::Key(key, paragraph);
+		for (const auto &run : page.GetRuns(i))
+			key = TextFit::Key(key, run.style, run.begin, run.end);
+	}
+
+	layout.scale = fit.Solve(
+		key,
+		[&] {
+			measure(1.0f);
+
+			// Wrapped text loses both width and height as it shrinks
+			auto estimate = layout.bounds.h > 0 ? height / layout.bounds.h : 1.0f;
+			if (wrap)
+				return std::sqrt(estimate);
+			if (layout.bounds.w > 0)
+				estimate = std::min(estimate, width / layout.bounds.w);
+			return estimate;
+		},
+		measure
+	);
+
+	// The last scale tried isn't always the answer
+	if (measured != layout.scale)
+		measure(layout.scale);
+
+	return layout;
+}
\ No newline at end of file
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Rendering/OpenGLFont.hpp"
+
+#include "Book.hpp"
+#include "TextFit.hpp"
+
+using namespace SnobasteCPP;
+
+// Where a page's text goes at one book size: the scales its header
+// and paragraphs fit at, the paragraphs wrapped at that scale and the
+// room each takes. Building one measures the text a handful of times,
+// drawing from it measures nothing.
+struct PageLayout {
+	// The scaled book background and its margin
+	struct Box {
+		unsigned width = 0;
+		unsigned height = 0;
+		std::size_t margin = 0;
+
+		bool operator==(const Box &other) const { return width == other.width && height == other.height && margin == other.margin; }
+		bool operator!=(const Box &other) const { return !(*this == other); }
+	};
+
+	Box box;
+
+	std::string header;
+	OpenGLFont::Span headerSpan;
+	float headerScale = 1.0f;
+	OpenGLFont::FontGlyph headerBounds;
+
+	float scale = 1.0f;
+	std::vector<std::string> paragraphs;
+	std::map<std::size_t, OpenGLFont::Span> paragraphSpans;
+	std::vector<OpenGLFont::FontGlyph> paragraphBounds;
+	// Widest paragraph, and all of them stacked
+	OpenGLFont::FontGlyph bounds;
+
+	// Fits page into box with its fonts, leaving their scales
+	// changed. font is null if the page's font isn't loaded.
+	static PageLayout Build(
+		const Book::Page &page,
+		const Box &box,
+		OpenGLFont &headerFont,
+		OpenGLFont *font,
+		const std::map<uint32_t, OpenGLFont::SpanItem> &spans,
+		TextFit &fit
+	);
+};
\ No newline at end of file
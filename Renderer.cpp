@@ -2,12 +2,15 @@
 
 #include <sstream>
 
+#include "GLFW/glfw3.h"
+
 #include "Utils/Enumerate.hpp"
 #include "Utils/GlobalViewerUtils.hpp"
 
 #include "Defines.hpp"
 #include "Engine.hpp"
 #include "Markdown.hpp"
+#include "WorkerPool.hpp"
 
 float Renderer::textureBuffer[8] = { 0, 0, 0, 1, 1, 1, 1, 0 };
 float Renderer::flipHorizontalTextureBuffer[8] = { 1, 0, 1, 1, 0, 1, 0, 0 };
@@ -26,6 +29,7 @@ float Renderer::halfTextureBufferReverse[8] = {
 Renderer::Renderer(Engine *engine, std::shared_ptr<Book> book) :
 	engine(engine),
 	book(book),
+	imageWindow(ImageWindowPages),
 	loading(this),
 	curl(this) {
 
@@ -36,109 +40,63 @@ Renderer::~Renderer() {
 }
 
 void Renderer::Init() {
-	for (unsigned short i = 2; i < 360; i++) {
-		circleIndexBuffer[((i - 2) * 3)] = 0;
-		circleIndexBuffer[((i - 2) * 3) + 1] = i - 1;
-		circleIndexBuffer[((i - 2) * 3) + 2] = i;
-	}
-
-	circleIndexBuffer[((360 - 2) * 3)] = 0;
-	circleIndexBuffer[((360 - 2) * 3) + 1] = 359;
-	circleIndexBuffer[((360 - 2) * 3) + 2] = 1;
-	circleIndexBuffer[((361 - 2) * 3)] = 0;
-	circleIndexBuffer[((361 - 2) * 3) + 1] = 1;
-	circleIndexBuffer[((361 - 2) * 3) + 2] = 2;
-
-	circleVertexBuffer[0] = 0;
-	circleVertexBuffer[1] = 0;
-
-	circleTexCoordBuffer[0] = 0.5;
-	circleTexCoordBuffer[1] = 0.5;
-
-	float degInRad;
-	for (int i = 0; i < 360; i++) {
-		degInRad = i * DEG2RAD;
-		circleVertexBuffer[(i * 2)] = static_cast<float>(sin(degInRad));
-		circleVertexBuffer[(i * 2) + 1] = static_cast<float>(cos(degInRad));
-	}
-
 	footerFont = std::make_unique<OpenGLFont>("Fonts/EBGaramond");
 	footerFont->InitFont();
 	footerFont->SetScale(0.60f);
 	footerFont->SetColor(Color::Black);
 	background.relativePath = "Images/book.png";
-	fpng::fpng_decode_file(
-		std::filesystem::absolute(FileRepository::registry->GetResourceDirectory() / background.relativePath).string().c_str(),
-		background.data,
-		background.width,
-		background.height,
-		background.channels,
-		4
-	);
+	background.Prepare(true);
 	background.UpdateRatio();
-	LoadTexture(background);
+	atlas.Add(background);
 
 	forewardBackground.relativePath = "Images/book_foreward.png";
-	fpng::fpng_decode_file(
-		std::filesystem::absolute(FileRepository::registry->GetResourceDirectory() / forewardBackground.relativePath).string().c_str(),
-		forewardBackground.data,
-		forewardBackground.width,
-		forewardBackground.height,
-		forewardBackground.channels,
-		4
-	);
+	forewardBackground.Prepare(true);
 	forewardBackground.UpdateRatio();
-	LoadTexture(forewardBackground);
+	atlas.Add(forewardBackground);
 
 	rightPage.relativePath = "Images/rightpage.png";
-	fpng::fpng_decode_file(
-		std::filesystem::absolute(FileRepository::registry->GetResourceDirectory() / rightPage.relativePath).string().c_str(),
-		rightPage.data,
-		rightPage.width,
-		rightPage.height,
-		rightPage.channels,
-		4
-	);
-	LoadTexture(rightPage);
+	rightPage.Prepare(true);
+	atlas.Add(rightPage);
 
 	leftPage.relativePath = "Images/leftpage.png";
-	fpng::fpng_decode_file(
-		std::filesystem::absolute(FileRepository::registry->GetResourceDirectory() / leftPage.relativePath).string().c_str(),
-		leftPage.data,
-		leftPage.width,
-		leftPage.height,
-		leftPage.channels,
-		4
-	);
-	LoadTexture(leftPage);
+	leftPage.Prepare(true);
+	atlas.Add(leftPage);
 
 	leftPageMiddle.relativePath = "Images/leftpagemiddle.png";
-	fpng::fpng_decode_file(
-		std::filesystem::absolute(FileRepository::registry->GetResourceDirectory() / leftPageMiddle.relativePath).string().c_str(),
-		leftPageMiddle.data,
-		leftPageMiddle.width,
-		leftPageMiddle.height,
-		leftPageMiddle.channels,
-		4
-	);
-	LoadTexture(leftPageMiddle);
+	leftPageMiddle.Prepare(true);
+	atlas.Add(leftPageMiddle);
 
 	leftPageOccupied.relativePath = "Images/leftpageoccupied.png";
-	auto loaded = fpng::fpng_decode_file(
-		std::filesystem::absolute(FileRepository::registry->GetResourceDirectory() / leftPageOccupied.relativePath).string().c_str(),
-		leftPageOccupied.data,
-		leftPageOccupied.width,
-		leftPageOccupied.height,
-		leftPageOccupied.channels,
-		4
-	);
-	LoadTexture(leftPageOccupied);
+	leftPageOccupied.Prepare(true);
+	atlas.Add(leftPageOccupied);
 
 	debugFont.InitFont();
 	debugFont.SetScale(0.60f);
 
+	sprites.Init();
+	transitions.Init();
+	uploader.Init(engine->GetLoader().get());
+
+	// Page images and covers are transcoded on the workers
+	// that decode them, so decide before any are loaded
+#if defined(SNOBASTE_GL)
+	ImagePipeline::SetCompressionSupported(glfwExtensionSupported("GL_EXT_texture_compression_s3tc"));
+#endif
+	ImagePipeline::SetCompressionEnabled(engine->GetMenu()->GetSetting("CompressTextures").value);
+	SetMemoryBudget(VideoMemoryBudgets[engine->GetMenu()->GetSetting("VideoMemory").value] * 1024 * 1024);
+
 	engine->GetMenu()->Init();
 	curl.Init();
+
+	// Everything queued above shares as few textures as possible
+	GLint maxTextureSize = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxTextureSize);
+	for (auto image : atlas.Build(textureRegistry, static_cast<uint32_t>(std::min(maxTextureSize, MaxAtlasSize)))) {
+		LoadTexture(*image);
+
+		// Chrome is never read again, so it can't be evicted
+		textureRegistry.Pin(image->texture);
+	}
 }
 
 void Renderer::Resize(int width, int height) {
@@ -146,12 +104,7 @@ void Renderer::Resize(int width, int height) {
 	this->height = height;
 
 	// Load viewport and matrix
-	glMatrixMode(GL_PROJECTION);
-	glLoadIdentity();
-	glOrtho(0, width, height, 0, -100.0f, 100.0f);
-
-	glMatrixMode(GL_MODELVIEW);
-	glLoadIdentity();
+	sprites.SetProjection(static_cast<float>(width), static_cast<float>(height));
 	glViewport(0, 0, width * 1.0f, height * 1.0f);
 
 	// Scale the background accordingly
@@ -185,6 +138,34 @@ void Renderer::Resize(int width, int height) {
 	if (book && book->GetBack())
 		book->GetBack()->Scale(width / 2.0f, height);
 
+	// Page images are decoded no larger than half the window,
+	// so growing past what they were fitted to reads them again
+	if (width > 0 && height > 0) {
+		auto [boundWidth, boundHeight] = ImagePipeline::GetDisplayBound();
+		ImagePipeline::SetDisplayBound((width + 1) / 2, height);
+
+		if (book && engine->GetState() == Engine::State::Book && ((width + 1) / 2 > boundWidth || height > boundHeight)) {
+			std::set<std::string> grown;
+			const auto check = [&](const Book::Page::Image &image) {
+				if (image.boundWidth && ((width + 1) / 2 > image.boundWidth || height > image.boundHeight) && textureRegistry.IsResident(image.texture))
+					grown.emplace(image.relativePath);
+			};
+
+			for (const auto &page : book->GetPages()) {
+				if (page.image)
+					check(*page.image);
+			}
+			if (book->GetBack())
+				check(*book->GetBack());
+
+			if (!grown.empty()) {
+				logger.WriteDebug("Redecoding ", grown.size(), " images for the larger window");
+				for (const auto &path : grown)
+					ReloadLarger(textureRegistry.Find(path));
+			}
+		}
+	}
+
 	engine->GetMenu()->Resize();
 
 #if defined(SNOBASTE_GL)
@@ -193,11 +174,6 @@ void Renderer::Resize(int width, int height) {
 	glDeleteFramebuffersOES(2, framebuffers);
 #endif
 
-	/*
-	delete[] pixels;
-	pixels = new uint8_t[width / 2.0f * height * 4];
-	*/
-
 	framebufferVertexBuffer[0] = 0;
 	framebufferVertexBuffer[1] = 0;
 	framebufferVertexBuffer[2] = 0;
@@ -262,40 +238,316 @@ void Renderer::Resize(int width, int height) {
 }
 
 void Renderer::LoadTexture(Book::Page::Image &image) {
-	// Already cached or empty
-	if (images.find(image.relativePath) != images.end() || image.data.empty()) {
-		// See https://cplusplus.com/reference/vector/vector/clear/
-		std::vector<uint8_t>().swap(image.data);
+	image.texture = textureRegistry.Acquire(image.relativePath);
+
+	// Already cached, on its way or empty
+	if (textureRegistry.IsResident(image.texture) || uploader.IsQueued(image.texture) || !image.HasPixels()) {
+		image.ReleasePixels();
 		return;
 	}
 
-	glEnable(GL_TEXTURE_2D);
+	uploader.Queue(image.texture, image);
+}
 
+GLuint Renderer::CreateTexture(const Book::Page::Image &image) {
 	GLuint textureId;
 	glGenTextures(1, &textureId);
 
 	glBindTexture(GL_TEXTURE_2D, textureId);
-	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	UploadTexture(image);
+
+	return textureId;
+}
+
+void Renderer::UploadTexture(const Book::Page::Image &image) {
+	const auto &upload = image.upload;
+
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, upload.levels.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
 	glTexParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, GL_FALSE);
-	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image.width, image.height, 0, GL_RGBA,
-		GL_UNSIGNED_BYTE, &image.data[0]);
-	glBindTexture(GL_TEXTURE_2D, 0);
 
-	glDisable(GL_TEXTURE_2D);
+	if (upload.levels.empty()) {
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image.width, image.height, 0, GL_RGBA,
+			GL_UNSIGNED_BYTE, &image.data[0]);
+		return;
+	}
+
+	// Straight from the cache mapping when it came from there
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(upload.levels.size() - 1));
+	for (const auto &[i, level] : Enumerate(upload.levels)) {
+		if (upload.IsCompressed()) {
+			glCompressedTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(i), upload.format, level.width, level.height, 0,
+				static_cast<GLsizei>(level.size), upload.GetLevel(i));
+		} else {
+			glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(i), GL_RGBA, level.width, level.height, 0, GL_RGBA,
+				GL_UNSIGNED_BYTE, upload.GetLevel(i));
+		}
+	}
+}
+
+GLuint Renderer::GetTexture(TextureRegistry::Handle handle) {
+	textureRegistry.Touch(handle);
+
+	if (auto texture = textureRegistry.Get(handle))
+		return texture;
+
+	if (uploader.IsQueued(handle))
+		return uploader.GetPlaceholder();
+
+	if (textureRegistry.IsEvicted(handle)) {
+		ReloadEvicted(handle);
+		return uploader.GetPlaceholder();
+	}
+
+	return 0;
+}
+
+void Renderer::ReloadEvicted(TextureRegistry::Handle handle) {
+	if (!reloading.emplace(handle).second) return;
+
+	auto image = std::make_shared<Book::Page::Image>();
+	image->relativePath = textureRegistry.GetPath(handle);
+
+	// Usually straight from the image cache
+	WorkerPool::Shared().Submit([this, handle, image] {
+		image->Prepare();
+
+		{
+			std::lock_guard<std::mutex> lock(residencyMutex);
+			reloadedImages.emplace_back(handle, image);
+		}
+		Invalidate();
+	});
+}
+
+void Renderer::ReloadLarger(TextureRegistry::Handle handle) {
+	if (reloading.find(handle) != reloading.end()) return;
+
+	// The old texture is drawn until the new one lands
+	growing.emplace(handle);
+	ReloadEvicted(handle);
+}
+
+void Renderer::UpdateReloads() {
+	decltype(reloadedImages) reloaded;
+	{
+		std::lock_guard<std::mutex> lock(residencyMutex);
+		if (reloadedImages.empty()) return;
+
+		reloaded.swap(reloadedImages);
+	}
+
+	for (auto &[handle, image] : reloaded) {
+		reloading.erase(handle);
+		bool grown = growing.erase(handle);
+
+		// Released or loaded some other way in the meantime
+		if (!(grown ? textureRegistry.IsResident(handle) : textureRegistry.IsEvicted(handle)) || uploader.IsQueued(handle)) continue;
+
+		if (!image->HasPixels()) {
+			logger.WriteDebug("Unable to reload ", image->relativePath);
+			continue;
+		}
+
+		// Pages drawn from it take the new size, so the
+		// next resize knows what it was fitted to
+		if (grown && book) {
+			const auto update = [&](Book::Page::Image &target) {
+				if (target.relativePath != image->relativePath) return;
+
+				target.width = image->width;
+				target.height = image->height;
+				target.boundWidth = image->boundWidth;
+				target.boundHeight = image->boundHeight;
+				target.UpdateRatio();
+			};
+
+			for (auto &page : book->GetPages()) {
+				if (page.image)
+					update(*page.image);
+			}
+			if (auto &back = book->GetBack()) {
+				update(*back);
+				back->Scale(width / 2.0f, height);
+			}
+		}
+
+		uploader.Queue(handle, *image);
+	}
+}
 
-	images[image.relativePath] = textureId;
+void Renderer::OnFilesChanged(const std::vector<std::filesystem::path> &paths) {
+	const auto resourceDirectory = std::filesystem::absolute(FileRepository::registry->GetResourceDirectory()).lexically_normal();
 
-	// See https://cplusplus.com/reference/vector/vector/clear/
-	std::vector<uint8_t>().swap(image.data);
+	// The loader threads own the book until we're showing
+	// it, and lay out its text while fonts are pending
+	auto book = engine->GetState() == Engine::State::Book && !fontsPending ? this->book : nullptr;
+
+	std::set<std::string> changedImages;
+	bool bookChanged = false;
+	for (const auto &path : paths) {
+		if (book && path == std::filesystem::absolute(book->GetPath()).lexically_normal())
+			bookChanged = true;
+		else
+			changedImages.emplace(path.lexically_relative(resourceDirectory).generic_string());
+	}
+
+	bool spreadChanged = false;
+	if (book && bookChanged) {
+		try {
+			auto changed = book->Reload();
+			logger.WriteDebug("Reloaded ", changed.size(), " pages of ", book->GetTitle());
+			layouts.clear();
+
+			// Fully loaded books decode during Reload, so nothing
+			// else can be writing into the images it replaced
+			if (book->GetLoadMode() != Book::LoadMode::Windowed)
+				book->ReleaseRetiredImages([](const auto &) { return false; });
+
+			// Text can't be laid out with styles the fonts weren't
+			// built with, so new styles take the full update
+			for (const auto &[hash, style] : book->GetStyles()) {
+				if (spans.find(hash) == spans.end() && Markdown::GetSpanForMarkdown(style)) {
+					bookUpdated = true;
+					break;
+				}
+			}
+
+			for (const auto &number : changed) {
+				if (number == currentPage || (currentPage != 0 && number == currentPage + 1))
+					spreadChanged = true;
+
+				if (auto page = book->GetPage(number); page && page->image && book->GetLoadMode() == Book::LoadMode::Hard)
+					LoadTexture(*page->image);
+			}
+
+			if (auto &back = book->GetBack()) {
+				LoadTexture(*back);
+				back->Scale(width / 2.0f, height);
+			}
+
+			// Pages were rebuilt, so point at the new ones
+			// and pick up new images around the current page
+			if (!spreadChanged) {
+				CollectPages();
+				RequestImages();
+			}
+		}
+		catch (std::exception &e) {
+			logger.WriteDebug("Keeping current ", book->GetTitle(), ": ", e.what());
+		}
+	}
+
+	bool chromeChanged = false;
+	for (auto image : { &background, &forewardBackground, &rightPage, &leftPage, &leftPageMiddle, &leftPageOccupied }) {
+		if (changedImages.find(image->relativePath) != changedImages.end())
+			chromeChanged = true;
+	}
+	if (book) {
+		for (auto &page : book->GetPages()) {
+			if (page.image && changedImages.find(page.image->relativePath) != changedImages.end()) {
+				if (page.number == currentPage || (currentPage != 0 && page.number == currentPage + 1))
+					spreadChanged = true;
+			}
+		}
+	}
+
+	ReloadTextures(changedImages, book);
+
+	if (chromeChanged)
+		Resize(width, height);
+
+	if (spreadChanged && !bookUpdated)
+		Reset();
+}
+
+void Renderer::ReloadTextures(const std::set<std::string> &paths, const std::shared_ptr<Book> &book) {
+	// Every image object drawn from each file
+	std::map<std::string, std::vector<Book::Page::Image *>> targets;
+	for (auto image : { &background, &forewardBackground, &rightPage, &leftPage, &leftPageMiddle, &leftPageOccupied }) {
+		if (paths.find(image->relativePath) != paths.end())
+			targets[image->relativePath].emplace_back(image);
+	}
+	if (book) {
+		for (auto &page : book->GetPages()) {
+			if (page.image && paths.find(page.image->relativePath) != paths.end())
+				targets[page.image->relativePath].emplace_back(page.image.get());
+		}
+		if (book->GetBack() && paths.find(book->GetBack()->relativePath) != paths.end())
+			targets[book->GetBack()->relativePath].emplace_back(book->GetBack().get());
+	}
+
+	// Only files that are already uploaded or queued need
+	// reloading, anything else is read fresh when it's next needed
+	std::vector<std::pair<std::string, Book::Page::Image>> reloaded;
+	for (const auto &path : paths) {
+		if (auto handle = textureRegistry.Find(path); textureRegistry.IsResident(handle) || uploader.IsQueued(handle)) {
+			Book::Page::Image image;
+			image.relativePath = path;
+			reloaded.emplace_back(path, std::move(image));
+		}
+	}
+
+	WorkerPool::Shared().ParallelFor(reloaded.size(), [&](std::size_t i) {
+		// Atlas chrome stays full size and uncompressed
+		reloaded[i].second.Prepare(textureRegistry.GetRegion(textureRegistry.Find(reloaded[i].first)) != nullptr);
+	});
+
+	glEnable(GL_TEXTURE_2D);
+	for (auto &[path, image] : reloaded) {
+		if (!image.HasPixels()) {
+			logger.WriteDebug("Unable to reload ", path);
+			continue;
+		}
+
+		auto handle = textureRegistry.Find(path);
+		if (textureRegistry.GetRegion(handle)) {
+			// Chrome that changed size no longer fits its
+			// atlas slot, so it moves to its own texture
+			if (!TextureAtlas::Replace(textureRegistry, handle, image)) {
+				textureRegistry.Set(handle, CreateTexture(image), image.GetPixelSize());
+				textureRegistry.Pin(handle);
+			}
+		} else if (uploader.IsQueued(handle)) {
+			// Still streaming the old pixels, so swap them out
+			uploader.Queue(handle, image);
+		} else {
+			glBindTexture(GL_TEXTURE_2D, textureRegistry.Get(handle));
+			UploadTexture(image);
+			textureRegistry.Set(handle, textureRegistry.Get(handle), image.GetPixelSize());
+		}
+
+		for (auto target : targets[path]) {
+			target->width = image.width;
+			target->height = image.height;
+			target->boundWidth = image.boundWidth;
+			target->boundHeight = image.boundHeight;
+			target->UpdateRatio();
+		}
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glDisable(GL_TEXTURE_2D);
+
+	// Same names, new pixels
+	MarkPagesDirty();
 }
 
 void Renderer::SetBook(std::shared_ptr<Book> book) { 
 	this->book = book; currentPage = 0;
 	currentPos = std::nullopt;
 
+	{
+		// Anything still decoding belongs to the old book
+		// and is dropped when it arrives
+		std::lock_guard<std::mutex> lock(residencyMutex);
+		residentImages.clear();
+		windowImages.clear();
+		residencyChanged = false;
+	}
+
 	bookUpdated = true;
 }
 
@@ -311,7 +563,7 @@ void Renderer::SetPage(std::size_t currentPage, bool threaded) {
 			// If we're odd, does the page before us
 			// only have an image? If so, retain the
 			// image animation.
-			if (const auto &page = book.get()->GetPages()[currentPage - 1]; !page.image || !page.paragraphs.empty()) {
+			if (const auto page = book->GetPage(currentPage - 1); !page || !page->image || !page->paragraphs.empty()) {
 				skipFirstPage = true;
 			}
 		}
@@ -340,18 +592,18 @@ void Renderer::UpdateBook() {
 	// Load fonts
 	// Load images into textures
 	for (auto &page : book->GetPages()) {
-		if (!page.second.font.empty()) {
-			fontPaths.emplace(page.second.font);
+		if (!page.font.empty()) {
+			fontPaths.emplace(page.font);
 		}
 
-		if (!page.second.titleStyle.empty()) {
-			page.second.style = magic_enum::enum_cast<OpenGLFont::Style>(page.second.titleStyle).value();
+		if (!page.titleStyle.empty()) {
+			page.style = magic_enum::enum_cast<OpenGLFont::Style>(page.titleStyle).value();
 			headerSpanItems.emplace_back(OpenGLFont::SpanItem{
-				page.second.style
+				page.style
 				});
 		}
 
-		if (auto &image = page.second.image) {
+		if (auto &image = page.image) {
 			LoadTexture(*image);
 		}
 	}
@@ -360,13 +612,6 @@ void Renderer::UpdateBook() {
 	if (book->GetBack())
 		LoadTexture(*book->GetBack());
 
-	headerFont = std::make_unique<OpenGLFont>(
-		FileRepository::registry->GetResourceDirectory() / "Fonts" / "Roboto",
-		headerSpanItems
-		);
-	headerFont->InitFont();
-	headerFont->SetColor(Color::Black);
-
 	// Gather styles
 	for (const auto &[hash, style] : book->GetStyles()) {
 		auto parsed = Markdown::GetSpanForMarkdown(style);
@@ -380,51 +625,283 @@ void Renderer::UpdateBook() {
 		}
 	}
 
-	// Clear any existing fonts
-	for (auto &font : fonts) {
-		font.second->KillFont();
-	}
-	fonts.clear();
-
-	for (const auto &font : fontPaths) {
-		auto iter = fonts.emplace(
-			std::make_pair(
-				font,
-				std::make_unique<OpenGLFont>(
-					FileRepository::registry->GetResourceDirectory() / font,
-					spanItems
+	// Building font atlases is the slow part, so it happens on
+	// the loader context while Render shows the loading screen.
+	// Text is laid out there too, before anything else uses them.
+	auto loaded = std::make_shared<BookFonts>();
+	auto generation = ++fontGeneration;
+	fontsPending = true;
+	textFit.Clear();
+	layouts.clear();
+
+	engine->GetLoader()->Submit(
+		[this, loaded, headerSpanItems, spanItems, fontPaths, book = book, box = GetLayoutBox(), spans = spans] {
+			loaded->header = std::make_unique<OpenGLFont>(
+				FileRepository::registry->GetResourceDirectory() / "Fonts" / "Roboto",
+				headerSpanItems
+				);
+			loaded->header->InitFont();
+			loaded->header->SetColor(Color::Black);
+
+			for (const auto &font : fontPaths) {
+				auto iter = loaded->fonts.emplace(
+					std::make_pair(
+						font,
+						std::make_unique<OpenGLFont>(
+							FileRepository::registry->GetResourceDirectory() / font,
+							spanItems
+							)
 					)
-			)
-		).first;
-		iter->second->InitFont();
-		iter->second->SetColor(Color::Black);
+				).first;
+				iter->second->InitFont();
+				iter->second->SetColor(Color::Black);
+			}
+
+			for (const auto &page : book->GetPages()) {
+				auto font = loaded->fonts.find(page.font);
+				loaded->layouts.emplace(
+					std::make_pair(
+						&page,
+						PageLayout::Build(page, box, *loaded->header, font != loaded->fonts.end() ? font->second.get() : nullptr, spans, textFit)
+					)
+				);
+			}
+		},
+		[this, loaded, generation](bool succeeded) {
+			// Superseded by a later update, or failed part way. A
+			// failure keeps the fonts there were, or the loading
+			// screen if there were none.
+			if (generation != fontGeneration || !succeeded || !loaded->header) {
+				if (loaded->header)
+					loaded->header->KillFont();
+				for (auto &font : loaded->fonts)
+					font.second->KillFont();
+
+				if (generation != fontGeneration) return;
+
+				logger.WriteDebug("Unable to load the book's fonts");
+				if (!headerFont) return;
+
+				fontsPending = false;
+				if (book)
+					UpdatePages();
+				return;
+			}
+
+			// Clear any existing fonts
+			if (headerFont)
+				headerFont->KillFont();
+			for (auto &font : fonts)
+				font.second->KillFont();
+
+			headerFont = std::move(loaded->header);
+			fonts = std::move(loaded->fonts);
+			layouts = std::move(loaded->layouts);
+			fontsPending = false;
+
+			if (book)
+				UpdatePages();
+		}
+	);
+}
+
+void Renderer::SetImageWindow(std::size_t imageWindow) {
+	this->imageWindow = imageWindow;
+
+	if (book)
+		RequestImages();
+}
+
+void Renderer::RequestImages() {
+	auto book = this->book;
+	if (!book || book->GetLoadMode() != Book::LoadMode::Windowed) return;
+
+	auto first = currentPage > imageWindow ? currentPage - imageWindow : 0;
+	auto last = currentPage + 1 + imageWindow;
+
+	// Nearest pages first, so a jump decodes the
+	// new spread before its neighbors
+	std::vector<std::pair<std::size_t, Book::Page::Image *>> window;
+	std::set<std::string> paths;
+	for (auto number = first; number <= last; ++number) {
+		auto page = book->GetPage(number);
+		if (!page) continue;
+
+		if (auto &image = page->image) {
+			auto distance = number >= currentPage ? number - currentPage : currentPage - number;
+			window.emplace_back(distance, image.get());
+			paths.emplace(image->relativePath);
+		}
 	}
+	std::stable_sort(window.begin(), window.end(), [](const auto &left, const auto &right) {
+		return left.first < right.first;
+	});
+
+	std::vector<Book::Page::Image *> spread;
+	std::vector<Book::Page::Image *> ahead;
+	{
+		std::lock_guard<std::mutex> lock(residencyMutex);
+		windowImages = std::move(paths);
+		residencyChanged = true;
+
+		for (const auto &[distance, image] : window) {
+			// An image whose texture is still around needs no decode,
+			// and one would race whatever is drawing with it
+			if (textureRegistry.IsResident(image->texture) || uploader.IsQueued(image->texture)) {
+				residentImages.emplace(image, Residency::Decoded);
+				continue;
+			}
 
-	UpdatePages();
+			if (residentImages.emplace(image, Residency::Decoding).second)
+				(distance <= 1 ? spread : ahead).emplace_back(image);
+		}
+	}
+
+	const auto finish = [this, book](Book::Page::Image *image) {
+		{
+			std::lock_guard<std::mutex> lock(residencyMutex);
+			decodedImages.emplace_back(book, image);
+		}
+		Invalidate();
+	};
+
+	// The spread itself is needed right away. This only blocks
+	// on jumps, since reading forward prefetches it.
+	WorkerPool::Shared().ParallelFor(spread.size(), [&](std::size_t i) {
+		spread[i]->Prepare();
+		finish(spread[i]);
+	});
+
+	for (auto image : ahead) {
+		WorkerPool::Shared().Submit([image, finish] {
+			image->Prepare();
+			finish(image);
+		});
+	}
+}
+
+void Renderer::UpdateResidency() {
+	if (!book || book->GetLoadMode() != Book::LoadMode::Windowed) return;
+
+	std::vector<std::pair<std::shared_ptr<Book>, Book::Page::Image *>> decoded;
+	std::set<std::string> window;
+	{
+		std::lock_guard<std::mutex> lock(residencyMutex);
+		if (!residencyChanged && decodedImages.empty()) return;
+
+		decoded.swap(decodedImages);
+		window = windowImages;
+		residencyChanged = false;
+	}
+
+	std::vector<Book::Page::Image *> evicted;
+	for (auto &[owner, image] : decoded) {
+		if (owner != book) continue;
+
+		if (window.find(image->relativePath) != window.end()) {
+			LoadTexture(*image);
+		} else {
+			// Left the window while decoding
+			image->ReleasePixels();
+			evicted.emplace_back(image);
+		}
+	}
+
+	std::set<std::string> evictedPaths;
+	{
+		std::lock_guard<std::mutex> lock(residencyMutex);
+
+		for (auto image : evicted)
+			residentImages.erase(image);
+
+		for (auto &page : book->GetPages()) {
+			auto &image = page.image;
+			if (!image || window.find(image->relativePath) != window.end()) continue;
+
+			// Covers are shared with the menu, so they stay
+			// resident and are never decoded again
+			if (image->relativePath == book->GetFront() || (book->GetBack() && image->relativePath == book->GetBack()->relativePath)) continue;
+
+			// In-flight decodes are cleaned up when they land
+			if (auto iter = residentImages.find(image.get()); iter != residentImages.end() && iter->second == Residency::Decoded) {
+				residentImages.erase(iter);
+				evictedPaths.emplace(image->relativePath);
+			}
+		}
+
+		for (auto &[owner, image] : decoded) {
+			if (owner == book) {
+				if (auto iter = residentImages.find(image); iter != residentImages.end())
+					iter->second = Residency::Decoded;
+			}
+		}
+
+		// Images a reload replaced can go once their decodes
+		// have landed, taking their entries with them
+		book->ReleaseRetiredImages([&](const Book::Page::Image &image) {
+			auto iter = residentImages.find(const_cast<Book::Page::Image *>(&image));
+			if (iter == residentImages.end()) return false;
+			if (iter->second == Residency::Decoding) return true;
+
+			residentImages.erase(iter);
+			return false;
+		});
+	}
+
+	for (const auto &path : evictedPaths) {
+		uploader.Cancel(textureRegistry.Find(path));
+		textureRegistry.Release(path);
+	}
 }
 
 void Renderer::StartHeaderAnimation() {
 	writingState = WritingState::Header;
 	headerAlpha = 0.0f;
-	ease = std::make_unique<Ease<float>>(0.0f, 1.0f, 1.0f);
+	timeline.Stop(ease);
+	ease = timeline.Start(0.0f, 1.0f, 1.0f, [this] {
+		skipFirstPage = false;
+		if (currentPos && !pages.empty())
+			FinishHeaderAnimation(0, pages[0]);
+	});
 }
 
 void Renderer::StartImageAnimation() {
 	writingState = WritingState::Image;
-	ease = std::make_unique<Ease<float>>(0.0f, 1.0f, 1.5f);
+	timeline.Stop(ease);
+	ease = timeline.Start(0.0f, 1.0f, 1.5f, [this] {
+		if (currentPos && currentPos->first != 0) {
+			FinishPage();
+		} else {
+			AdvanceParagraph();
+		}
+	});
 }
 
 void Renderer::UpdatePages() {
+	CollectPages();
+	RequestImages();
+
+	StartHeaderAnimation();
+}
+
+void Renderer::CollectPages() {
 	// Render current two pages
 	pages.clear();
-	if (auto page = book->GetPages().find(currentPage); page != book->GetPages().end()) {
-		pages.emplace_back(page->second);
+	pageParagraphs.clear();
+	if (auto page = book->GetPage(currentPage)) {
+		pages.emplace_back(*page);
 
-		if (currentPage != 0 && ++page != book->GetPages().end())
-			pages.emplace_back(page->second);
+		if (auto next = page + 1; currentPage != 0 && next != book->GetPages().data() + book->GetPages().size())
+			pages.emplace_back(*next);
 	}
 
-	StartHeaderAnimation();
+	for (const auto &page : pages) {
+		pageParagraphs.emplace_back(page.get().paragraphs.begin(), page.get().paragraphs.end());
+
+		// Jumping into a book that's still streaming in
+		if (page.get().image)
+			uploader.Prioritize(page.get().image->texture);
+	}
 }
 
 void Renderer::OnMouseClicked(double x, double y, int button, int mods) {
@@ -448,15 +925,23 @@ void Renderer::OnMouseClicked(double x, double y, int button, int mods) {
 	}
 }
 
+void Renderer::Invalidate() {
+	engine->GetPacer()->Invalidate();
+}
+
+void Renderer::WakeAt(double time) {
+	engine->GetPacer()->WakeAt(time);
+}
+
 void Renderer::AdvancePage(bool force, bool reverse) { 
-	nextPageStart = std::nullopt;
+	nextPageTime = std::nullopt;
 	skipFirstPage = false;
 
-	if (!book || writingState >= WritingState::Close) return;
+	if (!book || fontsPending || writingState >= WritingState::Close) return;
 
 	if (writingState == WritingState::Done || force) {
 		auto offset = reverse ? -2 : 2;
-		if (currentPage == 0 || (reverse && currentPage == 1 && book->GetPages().find(0) != book->GetPages().end()))
+		if (currentPage == 0 || (reverse && currentPage == 1 && book->GetPage(0)))
 			offset /= 2;
 
 		// Do we have any more pages?
@@ -467,18 +952,20 @@ void Renderer::AdvancePage(bool force, bool reverse) {
 				book->GetBack()->Scale(width / 2.0f, height);
 				curl.Start(curlDir, [&] {
 					writingState = WritingState::Move;
-					ease = std::make_unique<Ease<float>>(0.0f, 1.0f, 1.0f);
+					timeline.Stop(ease);
+					ease = timeline.Start(0.0f, 1.0f, 1.0f, [this] { writingState = WritingState::Back; });
 				});
 			}
 			return;
-		} else if (reverse && (currentPage == 0 || (currentPage == 1 && book->GetPages().find(0) == book->GetPages().end()))) {
+		} else if (reverse && (currentPage == 0 || (currentPage == 1 && !book->GetPage(0)))) {
 			return;
 		}
 
 		const auto nextPage = [&, offset] {
 			if (currentPage == 0) {
 				backgroundAlpha = 0.0f;
-				backgroundEase = std::make_unique<Ease<float>>(0.0f, 1.0f, 1.0f);
+				timeline.Stop(backgroundEase);
+				backgroundEase = timeline.Start(0.0f, 1.0f, 1.0f);
 			}
 
 			currentPage += offset;
@@ -489,11 +976,12 @@ void Renderer::AdvancePage(bool force, bool reverse) {
 		//paused = true;
 		if (curl.IsAnimating()) {
 			curl.Stop(true);
-			audioFadeEase.reset();
+			timeline.Stop(audioFadeEase);
 		} else {
 			curlDir = reverse ? Curl::CurlDir::Left : Curl::CurlDir::Right;
 			curl.Start(curlDir, nextPage);
-			audioFadeEase = std::make_unique<Ease<float>>(0.0f, 1.0f, 1.5f);
+			timeline.Stop(audioFadeEase);
+			audioFadeEase = timeline.Start(0.0f, 1.0f, 1.5f, [this] { engine->GetAudio()->Reset(); });
 		}
 	} else if (writingState == WritingState::Header) {
 		FinishHeaderAnimation(currentPos->first, pages[currentPos->first]);
@@ -503,56 +991,89 @@ void Renderer::AdvancePage(bool force, bool reverse) {
 }
 
 void Renderer::Reset(bool threaded) {
-	audioFadeEase.reset();
+	// Tweens, audio and pages belong to the render thread,
+	// so anywhere else only asks Render to reset
+	if (threaded) {
+		reset = true;
+		Invalidate();
+		return;
+	}
+
+	timeline.Stop(audioFadeEase);
 	engine->GetAudio()->Reset();
 	curl.Stop();
 	paused = false;
 	currentPos = std::nullopt;
 
-	if (!threaded) {
-		// Reset font scale
-		if (headerFont)
-			headerFont->SetScale(1.0f);
-		for (auto &[path, font] : fonts)
-			font->SetScale(1.0f);
-	} else {
-		reset = true;
-	}
+	// Reset font scale
+	if (headerFont)
+		headerFont->SetScale(1.0f);
+	for (auto &[path, font] : fonts)
+		font->SetScale(1.0f);
 
 	UpdatePages();
+	Invalidate();
+}
+
+GLuint Renderer::GetImageTexture(const Book::Page::Image &image, float *&textureBuffer) {
+	// Images that were never uploaded themselves may share
+	// a texture with one that was
+	auto handle = image.texture ? image.texture : textureRegistry.Find(image.relativePath);
+
+	// Texture coordinates are given over the whole image,
+	// map them into its part of the atlas
+	if (auto region = textureRegistry.GetRegion(handle)) {
+		for (int i = 0; i < 8; i += 2) {
+			atlasTextureBuffer[i] = region->u0 + textureBuffer[i] * (region->u1 - region->u0);
+			atlasTextureBuffer[i + 1] = region->v0 + textureBuffer[i + 1] * (region->v1 - region->v0);
+		}
+		textureBuffer = atlasTextureBuffer;
+	}
+
+	return GetTexture(handle);
 }
 
 void Renderer::RenderTexture(const Book::Page::Image &image, float *vertexBuffer, float *textureBuffer, bool color) {
 	if (!color)
-		glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
+		sprites.SetColor(1.0f, 1.0f, 1.0f, 1.0f);
 
-	glEnable(GL_TEXTURE_2D);
-	glBindTexture(GL_TEXTURE_2D, images[image.relativePath]);
+	auto texture = GetImageTexture(image, textureBuffer);
 
-	if (!vertexBuffer) {
-#ifdef DEBUG
-		if (image.scaledWidth > 20000 || image.scaledHeight > 20000)
-			throw std::runtime_error("Please scale your images first");
-#endif
-		imageVertexBuffer[3] = image.scaledHeight;
-		imageVertexBuffer[4] = image.scaledWidth;
-		imageVertexBuffer[5] = image.scaledHeight;
-		imageVertexBuffer[6] = image.scaledWidth;
+	sprites.Draw(texture, vertexBuffer ? vertexBuffer : GetImageVertexBuffer(image), textureBuffer);
+	sprites.LoadIdentity();
+}
 
-		glVertexPointer(2, GL_FLOAT, 0, imageVertexBuffer);
-	} else {
-		glVertexPointer(2, GL_FLOAT, 0, vertexBuffer);
+void Renderer::RenderTransition(const Book::Page::Image &image, Transitions::Effect effect, float progress, float *textureBuffer, bool color) {
+	if (!color)
+		sprites.SetColor(1.0f, 1.0f, 1.0f, 1.0f);
+
+	auto texture = GetImageTexture(image, textureBuffer);
+
+	if (!transitions.IsAvailable()) {
+		auto tint = sprites.GetColor();
+		sprites.SetColor(tint[0], tint[1], tint[2], tint[3] * progress);
+		sprites.Draw(texture, GetImageVertexBuffer(image), textureBuffer);
+		sprites.LoadIdentity();
+		return;
 	}
-	glTexCoordPointer(2, GL_FLOAT, 0, textureBuffer);
 
-	glEnableClientState(GL_VERTEX_ARRAY);
-	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, indexBuffer);
-	glDisableClientState(GL_VERTEX_ARRAY);
-	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+	// Whatever is held goes under the image
+	sprites.Flush();
+	transitions.Draw(sprites, effect, texture, GetImageVertexBuffer(image), textureBuffer, progress);
+	sprites.LoadIdentity();
+}
 
-	glDisable(GL_TEXTURE_2D);
-	glLoadIdentity();
+float *Renderer::GetImageVertexBuffer(const Book::Page::Image &image) {
+#ifdef DEBUG
+	if (image.scaledWidth > 20000 || image.scaledHeight > 20000)
+		throw std::runtime_error("Please scale your images first");
+#endif
+	imageVertexBuffer[3] = image.scaledHeight;
+	imageVertexBuffer[4] = image.scaledWidth;
+	imageVertexBuffer[5] = image.scaledHeight;
+	imageVertexBuffer[6] = image.scaledWidth;
+
+	return imageVertexBuffer;
 }
 
 float Renderer::AdvanceAudio() {
@@ -561,8 +1082,8 @@ float Renderer::AdvanceAudio() {
 	// Does this page / paragraph have sound?
 	// If so, load it.
 	float duration = -1.0f;
-	audioFadeEase.reset();
-	if (!page.sounds.empty() && currentPos->second < page.sounds.size() && engine->GetAudio()->Load(page.sounds[currentPos->second])) {
+	timeline.Stop(audioFadeEase);
+	if (!page.sounds.empty() && currentPos->second < page.sounds.size() && engine->GetAudio()->Load(std::string(page.sounds[currentPos->second]))) {
 		duration = engine->GetAudio()->GetDuration();
 		logger.WriteDebug("Duration: ", duration, "s");
 	} else {
@@ -587,7 +1108,7 @@ void Renderer::AdvanceParagraph() {
 
 		if (currentPos->first < pages.size() && pages[currentPos->first].get().title.empty()) {
 			writingState = WritingState::Paragraph;
-			ease.reset();
+			timeline.Stop(ease);
 		} else {
 			StartHeaderAnimation();
 		}
@@ -606,7 +1127,7 @@ void Renderer::AdvanceParagraph() {
 
 		logger.WriteDebug("Setting current writingState to ", magic_enum::enum_name(writingState));
 	} else {
-		writer.SetText(pages[currentPos->first].get().paragraphs[currentPos->second], AdvanceAudio());
+		writer.SetText(pageParagraphs[currentPos->first][currentPos->second], AdvanceAudio());
 	}
 }
 
@@ -615,7 +1136,7 @@ void Renderer::FinishHeaderAnimation(int i, std::reference_wrapper<Book::Page> p
 		StartImageAnimation();
 	} else {
 		writingState = WritingState::Paragraph;
-		ease.reset();
+		timeline.Stop(ease);
 	}
 	headerAlpha = 0.0f;
 }
@@ -623,34 +1144,49 @@ void Renderer::FinishHeaderAnimation(int i, std::reference_wrapper<Book::Page> p
 void Renderer::FinishPage() {
 	writingState = WritingState::Done;
 
-	if (engine->GetMenu()->GetSetting("Autoplay").value)
-		nextPageStart = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch());
+	if (engine->GetMenu()->GetSetting("Autoplay").value) {
+		nextPageTime = glfwGetTime() + AutoplayDelay;
+		WakeAt(*nextPageTime);
+	}
 }
 
 const std::function<void(GLuint, float *, float *)> Renderer::GetCurlRenderCallback(float *textureBuffer) {
 	return [&, textureBuffer](GLuint texture, float *vertBuffer, float *texBuffer) {
-		// Draw framebuffer as texture                      
-		glEnable(GL_TEXTURE_2D);
-		glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
-		glBindTexture(GL_TEXTURE_2D, texture);
-
-		glVertexPointer(2, GL_FLOAT, 0, vertBuffer);
-		glTexCoordPointer(2, GL_FLOAT, 0, textureBuffer ? textureBuffer : texBuffer);
-
-		glEnableClientState(GL_VERTEX_ARRAY);
-		glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-		glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, indexBuffer);
-		glDisableClientState(GL_VERTEX_ARRAY);
-		glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-
-		glDisable(GL_TEXTURE_2D);
-		glLoadIdentity();
+		// Draw framebuffer as texture
+		sprites.SetColor(1.0f, 1.0f, 1.0f, 1.0f);
+		sprites.Draw(texture, vertBuffer, textureBuffer ? textureBuffer : texBuffer);
+		sprites.LoadIdentity();
 	};
 }
 
 bool Renderer::Render() {
 	const auto &state = engine->GetState();
 
+	// Hand over whatever the loader context finished
+	engine->GetLoader()->Poll();
+
+	// Every tween moves on together, before anything reads one.
+	// Their callbacks run from here too.
+	timeline.Update(deltaTime);
+	if (!timeline.IsEmpty())
+		Invalidate();
+
+	// Textures stream in a few megabytes a frame,
+	// whatever we're showing
+	textureRegistry.NextFrame();
+	UpdateReloads();
+	uploader.Pump(textureRegistry);
+
+	// Stay within budget. Whatever is dropped is loaded
+	// again the next time it's drawn.
+	for (auto handle : uploader.Trim(PixelMemoryBudget))
+		textureRegistry.Evict(handle);
+	textureRegistry.Trim();
+
+	// Keep going until everything in flight has landed
+	if (!uploader.IsEmpty() || !reloading.empty() || engine->GetLoader()->IsBusy())
+		Invalidate();
+
 	if (state == Engine::State::Menu || state == Engine::State::Loading) {
 		engine->GetMenu()->Render();
 
@@ -671,31 +1207,36 @@ bool Renderer::Render() {
 		ret = true;
 	}
 
-	if (reset) {
-		// Reset font scale
-		if (headerFont)
-			headerFont->SetScale(1.0f);
-		for (auto &[path, font] : fonts)
-			font->SetScale(1.0f);
+	if (fontsPending) {
+		loading.Draw(deltaTime, 0.0f, 0.0f);
 
-		ret = true;
-		reset = false;
+		// Render FPS
+		if (engine->GetMenu()->GetSetting("FPSCounter").value)
+			DrawFPS();
+
+		return ret;
 	}
 
-	if (audioFadeEase) {
-		auto value = audioFadeEase->Advance(deltaTime);
-		if (value >= 1.0f) {
-			engine->GetAudio()->Reset();
-			audioFadeEase.reset();
-		} else {
-			engine->GetAudio()->SetVolume(1.0f - value);
-		}
+	UpdateResidency();
+
+	if (reset.exchange(false)) {
+		Reset();
+
+		ret = true;
+		MarkPagesDirty();
 	}
 
+	if (auto value = timeline.Value(audioFadeEase))
+		engine->GetAudio()->SetVolume(1.0f - *value);
+
+	// Anything that moves the book along needs another
+	// frame to show for it
+	const auto before = std::make_tuple(writingState, currentPos, currentPage);
+
 	if (book && state == Engine::State::Book) {
 		if (writingState >= WritingState::Move) {
-			glTranslatef(
-				width / 2.0f - background.scaledWidth / 2.0f + (ease ? ease->Advance(engine->GetManager()->GetDeltaTime()) * book.get()->GetBack()->scaledWidth / 2.0f : book.get()->GetBack()->scaledWidth / 2.0f),
+			sprites.Translate(
+				width / 2.0f - background.scaledWidth / 2.0f + timeline.Value(ease).value_or(1.0f) * book.get()->GetBack()->scaledWidth / 2.0f,
 				0.0f,
 				0.0f
 			);
@@ -705,25 +1246,19 @@ bool Renderer::Render() {
 			if (engine->GetMenu()->GetSetting("FPSCounter").value)
 				DrawFPS();
 
-			if (ease && ease->Value() >= 1.0f) {
-				writingState = WritingState::Back;
-				ease.reset();
-			}
-
 			return false;
 		}
 
 		// Render book texture
-		glTranslatef(width / 2 - background.scaledWidth / 2, height / 2 - background.scaledHeight / 2, 0.0f);
+		sprites.Begin();
+		sprites.Translate(width / 2 - background.scaledWidth / 2, height / 2 - background.scaledHeight / 2, 0.0f);
 		if (currentPage == 0 || (currentPage == 1 && curl.IsAnimating() && curlDir == Curl::CurlDir::Left)) {
 			RenderTexture(forewardBackground);
 		} else {
-			if (backgroundEase) {
+			if (auto alpha = timeline.Value(backgroundEase)) {
 				RenderTexture(forewardBackground);
-				glTranslatef(width / 2 - background.scaledWidth / 2, height / 2 - background.scaledHeight / 2, 0.0f);
-				glColor4f(1.0f, 1.0f, 1.0f, backgroundEase->Advance(engine->GetManager()->GetDeltaTime()));
-				if (backgroundEase->Value() >= 1.0f)
-					backgroundEase.reset();
+				sprites.Translate(width / 2 - background.scaledWidth / 2, height / 2 - background.scaledHeight / 2, 0.0f);
+				sprites.SetColor(1.0f, 1.0f, 1.0f, *alpha);
 			}
 
 			RenderTexture(
@@ -733,6 +1268,7 @@ bool Renderer::Render() {
 				true
 			);
 		}
+		sprites.End();
 
 		// Interate current position, if needed
 		if (!currentPos && !pages.empty()) {
@@ -741,14 +1277,38 @@ bool Renderer::Render() {
 				++currentPos->first;
 			}
 			// If we have text on this page, start animating it
-			if (auto &paragraphs = pages[currentPos->first].get().paragraphs; !paragraphs.empty())
+			if (auto &paragraphs = pageParagraphs[currentPos->first]; !paragraphs.empty())
 				writer.SetText(paragraphs.at(currentPos->second), AdvanceAudio());
 		}
 
+		// Reveal the paragraph being written, its page only
+		// needs drawing once another character shows up
+		if (currentPos && writingState != WritingState::Header && currentPos->first < pages.size() && currentPos->second < pageParagraphs[currentPos->first].size()) {
+			auto pos = writer.GetPos();
+			if (writer.Advance(paused ? 0 : deltaTime) || writer.GetText().first)
+				pageDirty[currentPos->first] = true;
+			if (auto wait = writer.GetTimeToNext())
+				WakeAt(glfwGetTime() + *wait);
+
+			// Start playing audio on our first
+			// rendered character
+			bool spicy = engine->GetMenu()->GetSetting("StreamingMode").value && pages[currentPos->first].get().spicy;
+			if (pos == 0 && writer.GetPos() != 0 && !spicy) {
+				engine->GetAudio()->Play();
+			}
+		}
+		if (writingState == WritingState::Header)
+			headerAlpha = timeline.Value(ease).value_or(1.0f);
+		UpdateDirtyPages();
+
 		for(auto &[i, page] : Enumerate(pages)) {
 			bool spicy = engine->GetMenu()->GetSetting("StreamingMode").value && page.get().spicy;
 
-			glLoadIdentity();
+			// A clean page's framebuffer already holds it
+			if (!pageDirty[i]) continue;
+			pageDirty[i] = false;
+
+			sprites.LoadIdentity();
 			glClearColor(1.0f, 1.0f, 1.0f, 0.0f);
 			if (i == 0) {
 #if defined(SNOBASTE_GL)
@@ -757,7 +1317,7 @@ bool Renderer::Render() {
 				glBindFramebufferOES(GL_FRAMEBUFFER_OES, framebuffers[0]);
 #endif
 				glClear(GL_COLOR_BUFFER_BIT);
-				glTranslatef(
+				sprites.Translate(
 					(width / 2.0f - std::floor(background.scaledWidth / 2.0f)), // Avoid subpixel weirdness
 					height / 2.0f - background.scaledHeight / 2.0f,
 					0
@@ -771,7 +1331,7 @@ bool Renderer::Render() {
 				glBindFramebufferOES(GL_FRAMEBUFFER_OES, framebuffers[1]);
 #endif
 				glClear(GL_COLOR_BUFFER_BIT);
-				glTranslatef(0.0f, height / 2.0f - background.scaledHeight / 2.0f, 0);
+				sprites.Translate(0.0f, height / 2.0f - background.scaledHeight / 2.0f, 0);
 
 				if (writingState == WritingState::Close) {
 					RenderTexture(
@@ -795,50 +1355,21 @@ bool Renderer::Render() {
 				OpenGLFont::FontMargin::FONT_MARGIN_NONE
 			);
 
-			if (writingState == WritingState::Header) {
-				if (i == 0 && (headerAlpha = ease->Advance(deltaTime)) >= 1.0f) {
-					skipFirstPage = false;
-					FinishHeaderAnimation(i, page);
-				}
-			}
+			const auto &layout = GetLayout(page);
 
 			// Does this page start an entry?
 			// If so, render a header
-			if (!page.get().title.empty()) {
-				std::stringstream header;
-				if (page.get().entryNumber)
-					header << "#" << *page.get().entryNumber << u8" \u2014 ";
-				header << page.get().title;
-
-				const auto size = header.str().size();
-				headerFont->SetSpan({
-					{ 0, { size - 2 - page.get().title.size(), OpenGLFont::Style::BoldItalic }},
-					{ size - 2 - page.get().title.size(), { size - 3, page.get().titleStyle.empty() ? OpenGLFont::Style::BoldItalic : page.get().style}}
-				});
-
-				header << " (" << page.get().date << ")";
-	
-				bool widthValid = false;
-				while (!widthValid) {
-					headerBounds = headerFont->GetBoundsForString(header.str());
-
-					if (headerBounds.w > background.scaledWidth / 2.0f - margin * 2) {
-						headerFont->SetScale(headerFont->GetScale() - FontScaleDelta);
-					} else {
-						widthValid = true;
-					}
-				}
-
-				if (i <= currentPos->first) {
-					headerFont->Draw(
-						header.str(),
-						(i == 1 ? background.scaledWidth / 2.0f : width / 2) - (headerBounds.w + margin),
-						height / 2 - background.scaledHeight / 2.0f + margin,
-						(writingState == WritingState::Header && (i == currentPos->first || skipFirstPage)) ? headerAlpha : 1.0f,
-						OpenGLFont::FontMargin::FONT_MARGIN_NONE,
-						OpenGLFont::FontMargin::FONT_MARGIN_NONE
-					);
-				}
+			if (!layout.header.empty() && i <= currentPos->first) {
+				headerFont->SetSpan(layout.headerSpan);
+				headerFont->SetScale(layout.headerScale);
+				headerFont->Draw(
+					layout.header,
+					(i == 1 ? background.scaledWidth / 2.0f : width / 2) - (layout.headerBounds.w + margin),
+					height / 2 - background.scaledHeight / 2.0f + margin,
+					(writingState == WritingState::Header && (i == currentPos->first || skipFirstPage)) ? headerAlpha : 1.0f,
+					OpenGLFont::FontMargin::FONT_MARGIN_NONE,
+					OpenGLFont::FontMargin::FONT_MARGIN_NONE
+				);
 			}
 
 			if (writingState == WritingState::Header && i == currentPos->first) {
@@ -849,114 +1380,36 @@ bool Renderer::Render() {
 
 			float offset = 0.0f;
 			if (auto font = fonts.find(page.get().font); font != fonts.end()) {
-				// Load each paragraph's span
-				std::map<std::size_t, OpenGLFont::Span> paragraphSpans;
-				for (const auto &[i, paragraph] : Enumerate(page.get().paragraphs)) {
-					if (auto iter = page.get().GetSpans().find(i); iter != page.get().GetSpans().end()) {
-						OpenGLFont::Span span;
-
-						for (const auto &s : iter->second) {
-							span.emplace(
-								std::make_pair(
-									std::get<1>(s),
-									std::make_pair(
-										std::get<2>(s),
-										spans.at(std::get<0>(s))
-									)
-								)
-							);
-						}
-
-						paragraphSpans.emplace(
-							std::make_pair(
-								i,
-								span
-							)
-						);
-					}
-				}
+				font->second->SetScale(layout.scale);
 
-				// Measure combined paragraph size
-				OpenGLFont::FontGlyph bounds;
-				bool widthValid = false;
-				while (!widthValid) {
-					// Do we need to wrap?
-					if (page.get().type == Book::Page::Type::Story ||
-						page.get().type == Book::Page::Type::Foreward) {
-						for (auto &paragraph : page.get().paragraphs) {
-							auto copy = StringUtils::ReplaceAll(paragraph, "\n", " ");
-							paragraph.clear();
-							Rectangle<int> rect = {
-								0,
-								0,
-								static_cast<int>(background.scaledWidth / 2.0f - margin * 2),
-								static_cast<int>(background.scaledHeight - margin * 4 - headerBounds.h * 2)
-							};
-
-							font->second->Wrap(
-								copy,
-								rect,
-								rect,
-								[&](std::string_view line, int y, bool hyphenate) {
-									auto string = std::string(line.data(), line.size());
-									if (hyphenate) string.push_back('-');
-									else string.push_back('\n');
-
-									paragraph.append(string);
-									return font->second->GetBounds(line).h;
-								}
-							);
-						}
-					}
-
-					bounds = OpenGLFont::FontGlyph();
-					for (const auto &[i, paragraph] : Enumerate(page.get().paragraphs)) {
-						if (auto iter = paragraphSpans.find(i); iter != paragraphSpans.end()) {
-							font->second->SetSpan(iter->second);
-						}
-						
-						auto paragraphBounds = font->second->GetBoundsForString(paragraph);
-						bounds.w = std::max(bounds.w, paragraphBounds.w);
-						bounds.h += paragraphBounds.h;
-						font->second->ClearSpan();
-					}
-
-					if ((page.get().type == Book::Page::Type::Poem && bounds.w > background.scaledWidth / 2.0f - margin * 2) ||
-						bounds.h > background.scaledHeight - margin * 4 - headerBounds.h * 2) {
-						font->second->SetScale(font->second->GetScale() - FontScaleDelta);
-						ret = true;
-					} else {
-						widthValid = true;
-					}
+				// The writer holds on to these strings, so
+				// they're updated in place
+				for (const auto &[p, paragraph] : Enumerate(layout.paragraphs)) {
+					if (pageParagraphs[i][p] != paragraph)
+						pageParagraphs[i][p] = paragraph;
 				}
 
-				if (auto &image = page.get().image; image) {
-					image->Scale(background.scaledWidth / 2.0f - margin * 1.5f, background.scaledHeight - margin * 1.5f - bounds.h);
+				if (auto &image = page.get().image; image && HasTexture(*image)) {
+					image->Scale(background.scaledWidth / 2.0f - margin * 1.5f, background.scaledHeight - margin * 1.5f - layout.bounds.h);
 					offset -= page.get().image->scaledHeight / 2.0f;
 				}
 
 				// Alternate justifications
 				auto justification = page.get().type == Book::Page::Type::Foreward ? OpenGLFont::Justification::Center : OpenGLFont::Justification::Left;
-				for (const auto &[p, paragraph] : Enumerate(page.get().paragraphs)) {
+				for (const auto &[p, paragraph] : Enumerate(pageParagraphs[i])) {
 					if (i > currentPos->first || (i == currentPos->first && p > currentPos->second)) break;
 
-					if (auto iter = paragraphSpans.find(p); iter != paragraphSpans.end()) {
+					if (auto iter = layout.paragraphSpans.find(p); iter != layout.paragraphSpans.end()) {
 						font->second->SetSpan(iter->second);
 					}
 
 					std::optional<std::pair<bool, std::string>> write = std::nullopt;
-					if (i == currentPos->first && p == currentPos->second) {
-						auto pos = writer.GetPos();
-						write = writer.GetText(paused ? 0 : deltaTime);
-
-						// Start playing audio on our first
-						// rendered character
-						if (pos == 0 && !write->second.empty() && !spicy) {
-							engine->GetAudio()->Play();
-						}
-					}
+					if (i == currentPos->first && p == currentPos->second)
+						write = writer.GetText();
 
-					auto paragraphBounds = font->second->GetBoundsForString(write && justification == OpenGLFont::Justification::Left ? write->second : paragraph);
+					// Only centered and right justified text is
+					// placed by its width, always the whole paragraph's
+					const auto &paragraphBounds = layout.paragraphBounds[p];
 
 					float xOrigin = ( i == 0 && currentPage != 0 ? (
 							justification == OpenGLFont::Justification::Left ?
@@ -976,7 +1429,7 @@ bool Renderer::Render() {
 					font->second->Draw(
 						write ? write->second : paragraph,
 						xOrigin,
-						height / 2 - bounds.h / 2 + offset,
+						height / 2 - layout.bounds.h / 2 + offset,
 						skipFirstPage ? headerAlpha : 1.0f,
 						OpenGLFont::FontMargin::FONT_MARGIN_NONE,
 						OpenGLFont::FontMargin::FONT_MARGIN_NONE,
@@ -991,7 +1444,7 @@ bool Renderer::Render() {
 						AdvanceParagraph();
 					}
 
-					offset += font->second->GetBoundsForString(paragraph).h;
+					offset += paragraphBounds.h;
 
 					if (page.get().type == Book::Page::Type::Poem)
 						justification = (justification == OpenGLFont::Justification::Left ? OpenGLFont::Justification::Right : OpenGLFont::Justification::Left);
@@ -1001,12 +1454,12 @@ bool Renderer::Render() {
 			// Does this page have an image?
 			// If so, render it after the paragraphs
 			auto &image = page.get().image;
-			if (image && (static_cast<int>(writingState) > static_cast<int>(WritingState::Paragraph) || ((i == 0 && writingState > WritingState::Header) || (currentPos->first == 1 && writingState == WritingState::Header)))) {
+			if (image && HasTexture(*image) && (static_cast<int>(writingState) > static_cast<int>(WritingState::Paragraph) || ((i == 0 && writingState > WritingState::Header) || (currentPos->first == 1 && writingState == WritingState::Header)))) {
 				if (page.get().paragraphs.empty())
 					image->Scale(background.scaledWidth / 2.0f - margin * 1.5f, background.scaledHeight - margin * 1.5f);
 
 				auto center = ((background.scaledWidth / 2.0f - margin * 1.5f) - image->scaledWidth) / 2.0f;
-				glTranslatef(
+				sprites.Translate(
 					(
 						i == 0 ?
 							margin * 0.25f + width / 2.0f - background.scaledWidth / 4.0f - image->scaledWidth / 2.0f :
@@ -1016,75 +1469,24 @@ bool Renderer::Render() {
 					0
 				);
 
-				// Are we animating the image?
-				if (writingState == WritingState::Image) {
-					glTranslatef(image->scaledWidth / 2.0f, image->scaledHeight / 2.0f, 0.0f);
-
-					auto value = paused ? ease->Value() : ease->Advance(deltaTime);
-					if (value >= 1.0f) {
-						ease.reset();
-
-						if (i != 0) {
-							FinishPage();
-						} else {
-							AdvanceParagraph();
-						}
-					}
-
-					float degInRad;
-					for (int i = 0; i < 360; i++) {
-						degInRad = i * DEG2RAD;
-
-						circleTexCoordBuffer[i * 2] = ((std::sin(degInRad) * value)) * (static_cast<float>(image->scaledHeight) / image->scaledWidth) + 0.5;
-						circleTexCoordBuffer[i * 2 + 1] = (std::cos(degInRad) * value) + 0.5;
-					}
-
-					if (spicy)
-						glColor4f(0.0f, 0.0f, 0.0f, 1.0f);
-					else
-						glColor4f(1.0f, 1.0f, 1.0f, 1.0f);
-
-					glScalef(image->scaledHeight * value, image->scaledHeight * value, 1.0f);
-					glEnable(GL_TEXTURE_2D);
-					glBindTexture(GL_TEXTURE_2D, images[image->relativePath]);
-					glVertexPointer(2, GL_FLOAT, 0, circleVertexBuffer.data());
-					glTexCoordPointer(2, GL_FLOAT, 0, circleTexCoordBuffer.data());
-					glEnableClientState(GL_VERTEX_ARRAY);
-					glEnableClientState(GL_TEXTURE_COORD_ARRAY);
-					glDrawElements(GL_TRIANGLE_FAN, circleIndexBuffer.size(), GL_UNSIGNED_SHORT, circleIndexBuffer.data());
-					glDisableClientState(GL_TEXTURE_COORD_ARRAY);
-					glDisableClientState(GL_VERTEX_ARRAY);
-					glLoadIdentity();
-					glDisable(GL_TEXTURE_2D);
-				} else {
-					if (spicy)
-						glColor4f(0.0f, 0.0f, 0.0f, 1.0f);
+				if (spicy)
+					sprites.SetColor(0.0f, 0.0f, 0.0f, 1.0f);
 
+				// Are we animating the image?
+				if (writingState == WritingState::Image)
+					RenderTransition(*image, Transitions::Effect::Reveal, timeline.Value(ease).value_or(1.0f), textureBuffer, spicy);
+				else
 					RenderTexture(*image, nullptr, textureBuffer, spicy);
-				}
 			}
+			pageImages[i] = image ? textureRegistry.Get(image->texture) : 0;
 
 			// Unbind framebuffer
 			UnbindFramebuffer();
-
-			/*
-			// Get texture from framebuffer
-			glEnable(GL_TEXTURE_2D);
-			glBindTexture(GL_TEXTURE_2D, textures[0]);
-			glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
-			int target;
-			for (int p = 0; p < width / 2.0f * height; ++p) {
-				target = rand() % (width / 2 * height);
-				std::swap(pixels[p * 4], pixels[target * 4]);
-				std::swap(pixels[p * 4 + 1], pixels[target * 4 + 1]);
-				std::swap(pixels[p * 4 + 2], pixels[target * 4 + 2]);
-			}
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width / 2.0f, height, 0, GL_RGBA,
-				GL_UNSIGNED_BYTE, pixels);
-			glDisable(GL_TEXTURE_2D);
-			*/
 		}
-		
+
+		// Both halves and the curl over them, without anything
+		// drawn in between
+		sprites.Begin();
 		if (curl.IsAnimating()) {
 			if (curlDir == Curl::CurlDir::Right) {
 				if (currentPage != 0)
@@ -1094,24 +1496,25 @@ bool Renderer::Render() {
 					textures[1],
 					width / 2.0f, 0.0f,
 					framebufferVertexBuffer,
-					GetCurlRenderCallback(),
 					deltaTime,
+					nullptr,
 					std::nullopt,
 					false,
 					false,
 					writingState == WritingState::Close ? book->GetBack() : static_cast<std::optional<std::reference_wrapper<std::unique_ptr<Book::Page::Image>>>>(std::nullopt)
 				);
 			} else {
-				glTranslatef(width / 2.0f, 0.0f, 0);
+				sprites.Translate(width / 2.0f, 0.0f, 0);
 				GetCurlRenderCallback()(textures[1], framebufferVertexBuffer, framebufferTextureBuffer);
-				curl.Render(textures[0], -width / 2.0f, 0.0f, framebufferVertexBuffer, GetCurlRenderCallback(), deltaTime, width / 2.0f);
+				curl.Render(textures[0], -width / 2.0f, 0.0f, framebufferVertexBuffer, deltaTime, nullptr, width / 2.0f);
 			}
 		} else {
-			glTranslatef(width / 2.0f, 0.0f, 0);
+			sprites.Translate(width / 2.0f, 0.0f, 0);
 			GetCurlRenderCallback()(textures[1], framebufferVertexBuffer, framebufferTextureBuffer);
 			if (currentPage != 0)
 				GetCurlRenderCallback()(textures[0], framebufferVertexBuffer, framebufferTextureBuffer);
 		}
+		sprites.End();
 	}
 
 	// Render FPS
@@ -1120,13 +1523,17 @@ bool Renderer::Render() {
 
 	// Has enough time passed in autoplay mode that we
 	// should turn the page?
-	if (nextPageStart && std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()) - *nextPageStart > 2s)
+	if (nextPageTime && glfwGetTime() >= *nextPageTime)
 		AdvancePage();
 
+	if (ret || before != std::make_tuple(writingState, currentPos, currentPage))
+		Invalidate();
+
 	return ret;
 }
 
 void Renderer::Back() {
+	MarkPagesDirty();
 	engine->GetAudio()->Reset();
 	engine->GetMenu()->Show();
 	engine->GetMenu()->Resize();
@@ -1140,7 +1547,14 @@ void Renderer::DrawFPS() {
 
 		if (totalFrametime >= 0.50f) {
 			std::stringstream fpsStream;
-			fpsStream << static_cast<int>(1.0f / (totalFrametime / frametimes)) << " FPS";
+			const auto &stats = textureRegistry.GetStats();
+			fpsStream << static_cast<int>(1.0f / (totalFrametime / frametimes)) << " FPS, "
+				<< stats.count << " textures (" << stats.bytes / (1024 * 1024);
+			if (stats.budget)
+				fpsStream << " of " << stats.budget / (1024 * 1024);
+			fpsStream << " MB, " << stats.evictions << " evicted, "
+				<< uploader.GetQueuedBytes() / (1024 * 1024) << " MB queued), "
+				<< sprites.TakeDrawCalls() / frametimes << " sprite draws";
 			fps = fpsStream.str();
 
 			totalFrametime = 0.0;
@@ -1159,6 +1573,39 @@ void Renderer::DrawFPS() {
 	}
 }
 
+const PageLayout &Renderer::GetLayout(const Book::Page &page) {
+	auto box = GetLayoutBox();
+	if (auto iter = layouts.find(&page); iter != layouts.end() && iter->second.box == box)
+		return iter->second;
+
+	auto font = fonts.find(page.font);
+	return layouts.insert_or_assign(
+		&page,
+		PageLayout::Build(page, box, *headerFont, font != fonts.end() ? font->second.get() : nullptr, spans, textFit)
+	).first->second;
+}
+
+void Renderer::UpdateDirtyPages() {
+	PageKey key = { currentPage, currentPos, writingState, width, height, fontGeneration, engine->GetMenu()->GetSetting("StreamingMode").value != 0 };
+	if (key != pageKey) {
+		pageKey = key;
+		MarkPagesDirty();
+	}
+
+	// Fading headers and revealing images change every frame
+	if (writingState == WritingState::Header || writingState == WritingState::Image)
+		MarkPagesDirty();
+
+	// Redraw once an image that was still loading arrives. One
+	// evicted since it was drawn is still in the framebuffer.
+	for (const auto &[i, page] : Enumerate(pages)) {
+		if (auto &image = page.get().image) {
+			if (auto texture = textureRegistry.Get(image->texture); texture && texture != pageImages[i])
+				pageDirty[i] = true;
+		}
+	}
+}
+
 inline void Renderer::UnbindFramebuffer() const {
 #if defined(SNOBASTE_GL)
 	glBindFramebufferEXT(GL_FRAMEBUFFER_EXT, 0);
@@ -1168,6 +1615,9 @@ inline void Renderer::UnbindFramebuffer() const {
 }
 
 void Renderer::Cleanup() {
+	// Nothing else gets created behind our back
+	engine->GetLoader()->Stop();
+
 #if defined(SNOBASTE_GL)
 	glDeleteFramebuffersEXT(2, framebuffers);
 #elif defined(SNOBASTE_GLES)
@@ -1175,8 +1625,11 @@ void Renderer::Cleanup() {
 #endif
 	glDeleteTextures(2, textures);
 
-	for (auto &[path, image] : images)
-		glDeleteTextures(1, &image);
+	uploader.Cleanup();
+	sprites.Cleanup();
+	transitions.Cleanup();
+	curl.Cleanup();
+	textureRegistry.ReleaseAll();
 
 	for (auto &[path, font] : fonts)
 		font->KillFont();
@@ -1,15 +1,25 @@
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <tuple>
 
 #include "Filesystem/FileRepository.hpp"
 #include "Rendering/OpenGLFont.hpp"
 
 #include "Book.hpp"
 #include "Curl.hpp"
-#include "Ease.hpp"
 #include "GhostWriter.hpp"
 #include "Loading.hpp"
+#include "PageLayout.hpp"
+#include "SpriteBatch.hpp"
+#include "TextureAtlas.hpp"
+#include "TextureRegistry.hpp"
+#include "TextureUploader.hpp"
+#include "Timeline.hpp"
+#include "Transitions.hpp"
 
 using namespace SnobasteCPP;
 
@@ -31,10 +41,39 @@ public:
 	void SetPage(std::size_t currentPage, bool threaded = false);
 	void AdvancePage(bool force = false, bool reverse = false);
 
+	// Asks the main loop for another frame, right away or once
+	// glfwGetTime reaches time. Invalidate is safe from any thread.
+	void Invalidate();
+	void WakeAt(double time);
+
 	void SetDeltaTime(float deltaTime) { this->deltaTime = deltaTime; }
 
+	// Pages on either side of the current spread whose images are
+	// kept decoded and uploaded when the book is windowed
+	void SetImageWindow(std::size_t imageWindow);
+
+	// Textures past bytes are evicted least recently drawn
+	// first and loaded again when needed. Zero is unlimited.
+	void SetMemoryBudget(std::size_t bytes) { textureRegistry.SetBudget(bytes); }
+
+	// Hot reload. Re-parses the open book if its source changed,
+	// re-uploads textures whose files changed and refreshes the
+	// open spread if anything on it was touched.
+	void OnFilesChanged(const std::vector<std::filesystem::path> &paths);
+
+	// Queues image's pixels for upload. It's drawn with a
+	// placeholder until the upload finishes.
 	void LoadTexture(Book::Page::Image &image);
+	// Queues fixed UI images for the shared atlas built at the
+	// end of Init. Only valid during Init.
+	void LoadAtlasTexture(Book::Page::Image &image) { atlas.Add(image); }
 	void RenderTexture(const Book::Page::Image &image, float *vertexBuffer = nullptr, float *textureBuffer = Renderer::textureBuffer, bool color = false);
+	// Draws image partway through effect, at progress from 0 to 1
+	void RenderTransition(const Book::Page::Image &image, Transitions::Effect effect, float progress, float *textureBuffer = Renderer::textureBuffer, bool color = false);
+	// The texture image is drawn with, pointing textureBuffer at
+	// its part of an atlas if it's in one. Only good until the next
+	// image is looked up.
+	GLuint GetImageTexture(const Book::Page::Image &image, float *&textureBuffer);
 
 	int GetWidth() const { return width; }
 	int GetHeight() const { return height; }
@@ -42,6 +81,9 @@ public:
 	void Back();
 
 	Curl &GetCurl() { return curl; }
+	SpriteBatch &GetSprites() { return sprites; }
+	// Advanced once a frame, before anything is drawn
+	Timeline &GetTimeline() { return timeline; }
 
 	void OnMouseClicked(double x, double y, int button, int mods);
 
@@ -51,7 +93,9 @@ public:
 
 	const auto GetMargin() const { return margin; }
 
-	GLuint GetImage(const std::string &path) const { return images.at(path); }
+	GLuint GetImage(const std::string &path) { return GetTexture(textureRegistry.Find(path)); }
+	const TextureRegistry::Stats &GetTextureStats() const { return textureRegistry.GetStats(); }
+	std::size_t GetQueuedBytes() const { return uploader.GetQueuedBytes(); }
 
 	const Book::Page::Image &GetBackground() const { return background; }
 	const Book::Page::Image &GetForewardBackground() const { return forewardBackground; }
@@ -69,8 +113,40 @@ private:
 		Back
 	};
 
+	enum class Residency {
+		Decoding,
+		Decoded
+	};
+
 	void UpdateBook();
 	void UpdatePages();
+	void CollectPages();
+
+	// Queues decodes for windowed images around the current page.
+	// Safe to call from the loader thread.
+	void RequestImages();
+
+	// Uploads decoded window images and evicts the ones that
+	// left the window. Render thread only.
+	void UpdateResidency();
+
+	// Queued and evicted images count, they have their size already
+	bool HasTexture(const Book::Page::Image &image) const {
+		return textureRegistry.IsResident(image.texture) || uploader.IsQueued(image.texture) || textureRegistry.IsEvicted(image.texture);
+	}
+
+	// The texture to draw for handle, marking it used. Evicted
+	// textures are reloaded and drawn with the placeholder.
+	GLuint GetTexture(TextureRegistry::Handle handle);
+
+	// Decodes an evicted texture again on the workers
+	void ReloadEvicted(TextureRegistry::Handle handle);
+	// Decodes a resident texture again for a larger window,
+	// swapping it in once uploaded
+	void ReloadLarger(TextureRegistry::Handle handle);
+
+	// Queues reloads that finished decoding. Render thread only.
+	void UpdateReloads();
 
 	void AdvanceParagraph();
 
@@ -80,6 +156,9 @@ private:
 
 	inline void UnbindFramebuffer() const;
 
+	// Redraws both page framebuffers on the next frame
+	void MarkPagesDirty() { pageDirty.fill(true); }
+
 	void StartHeaderAnimation();
 	void StartImageAnimation();
 
@@ -92,16 +171,65 @@ private:
 
 	std::unique_ptr<OpenGLFont> headerFont;
 	std::unique_ptr<OpenGLFont> footerFont;
-	std::map<std::string, std::unique_ptr<OpenGLFont>> fonts;
+	std::map<std::string, std::unique_ptr<OpenGLFont>, std::less<>> fonts;
 	std::atomic<bool> bookUpdated = false;
+
+	// A book's fonts, built on the loader context while
+	// the loading screen stays up
+	struct BookFonts {
+		std::unique_ptr<OpenGLFont> header;
+		std::map<std::string, std::unique_ptr<OpenGLFont>, std::less<>> fonts;
+		std::map<const Book::Page *, PageLayout> layouts;
+	};
+	bool fontsPending = false;
+	std::size_t fontGeneration = 0;
+
+	// Each page's text laid out at the current book size, built
+	// along with the fonts or on first use after a resize
+	const PageLayout &GetLayout(const Book::Page &page);
+	PageLayout::Box GetLayoutBox() const { return { background.scaledWidth, background.scaledHeight, margin }; }
+	std::map<const Book::Page *, PageLayout> layouts;
+	TextFit textFit;
 	std::shared_ptr<Book> book = nullptr;
 	std::size_t currentPage = 0;
 	std::size_t margin = 64;
 
-	std::map<std::string, GLuint> images;
+	// Upper bound on atlas size, whatever the driver allows
+	static constexpr GLint MaxAtlasSize = 8192;
+
+	// Decodes and re-uploads the resident textures for paths,
+	// updating the dimensions of every image drawn from them
+	void ReloadTextures(const std::set<std::string> &paths, const std::shared_ptr<Book> &book);
+
+	GLuint CreateTexture(const Book::Page::Image &image);
+	// Uploads image into the bound texture, with its mip chain
+	// when it was compressed
+	void UploadTexture(const Book::Page::Image &image);
+
+	TextureRegistry textureRegistry;
+	TextureUploader uploader;
+	SpriteBatch sprites;
+	Transitions transitions;
+	Timeline timeline;
+	TextureAtlas atlas;
+	float atlasTextureBuffer[8];
+
+	std::size_t imageWindow;
+	std::mutex residencyMutex;
+	std::map<Book::Page::Image *, Residency> residentImages;
+	std::vector<std::pair<std::shared_ptr<Book>, Book::Page::Image *>> decodedImages;
+	std::set<std::string> windowImages;
+	bool residencyChanged = false;
+
+	std::set<TextureRegistry::Handle> reloading;
+	// Of those, the ones being decoded larger
+	std::set<TextureRegistry::Handle> growing;
+	std::vector<std::pair<TextureRegistry::Handle, std::shared_ptr<Book::Page::Image>>> reloadedImages;
 
 	float backgroundVertexBuffer[8];
 	float imageVertexBuffer[8] = { 0, 0, 0, 0, 0, 0, 0, 0 };
+	// imageVertexBuffer, sized to image
+	float *GetImageVertexBuffer(const Book::Page::Image &image);
 	static float textureBuffer[8];
 	static float flipHorizontalTextureBuffer[8];
 	unsigned short indexBuffer[6] = { 0, 1, 2, 0, 2, 3 };
@@ -121,7 +249,12 @@ private:
 	// Render vars
 	std::vector<std::reference_wrapper<Book::Page>> pages;
 
-	std::unique_ptr<Ease<float>> ease;
+	// Copies of each page's paragraphs, rewrapped in place
+	// as the fonts are scaled to fit
+	std::vector<std::vector<std::string>> pageParagraphs;
+
+	// Header fade, image reveal and book move, one at a time
+	Timeline::Handle ease;
 
 	Loading loading;
 	Curl curl;
@@ -134,18 +267,27 @@ private:
 	float framebufferVertexBuffer[8];
 	float framebufferTextureBuffer[8] = { 0, 1, 0, 0, 1, 0, 1, 1 };
 
-	uint8_t *pixels = nullptr;
-
 	unsigned int framebuffers[2] = { 0, 0 };
 	unsigned int textures[2] = { 0, 0 };
 
+	// Pages are only drawn into their framebuffers when something
+	// on them changes, otherwise they're just composited
+	void UpdateDirtyPages();
+	std::array<bool, 2> pageDirty = { true, true };
+	// The texture each page's image was drawn with, 0 while
+	// it was still loading
+	std::array<GLuint, 2> pageImages = { 0, 0 };
+	// Everything else a page's content depends on
+	using PageKey = std::tuple<std::size_t, std::optional<std::pair<std::size_t, std::size_t>>, WritingState, int, int, std::size_t, bool>;
+	std::optional<PageKey> pageKey;
+
 	bool paused = false;
-	bool reset = false;
+	// Set by a threaded SetPage for Render to pick up
+	std::atomic<bool> reset = false;
 
 	Curl::CurlDir curlDir = Curl::CurlDir::Right;
 
 	float headerAlpha = 0.0f;
-	OpenGLFont::FontGlyph headerBounds;
 
 	OpenGLFont debugFont;
 	double totalFrametime = 0.0;
@@ -154,16 +296,13 @@ private:
 	void DrawFPS();
 
 	float backgroundAlpha = 1.0f;
-	std::unique_ptr<Ease<float>> backgroundEase;
-
-	std::optional<std::chrono::milliseconds> nextPageStart = std::nullopt;
+	Timeline::Handle backgroundEase;
 
-	std::array<float, 361 * 2> circleVertexBuffer;
-	std::array<uint16_t, 360 * 3> circleIndexBuffer;
-	std::array<float, 361 * 2> circleTexCoordBuffer;
+	// When autoplay turns the page, from glfwGetTime
+	std::optional<double> nextPageTime = std::nullopt;
 
 	static float halfTextureBufferReverse[8];
 
-	std::unique_ptr<Ease<float>> audioFadeEase;
+	Timeline::Handle audioFadeEase;
 	std::atomic<bool> skipFirstPage = false;
 };
\ No newline at end of file
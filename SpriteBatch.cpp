@@ -0,0 +1,306 @@
+#include "SpriteBatch.hpp"
+
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+
+namespace {
+	const char *VertexSource = R"(#version 330 core
+layout(location = 0) in vec4 vertices01;
+layout(location = 1) in vec4 vertices23;
+layout(location = 2) in vec4 texCoords01;
+layout(location = 3) in vec4 texCoords23;
+layout(location = 4) in vec4 color;
+layout(location = 5) in vec3 rowX;
+layout(location = 6) in vec3 rowY;
+layout(location = 7) in vec3 rowZ;
+
+uniform mat4 projection;
+
+out vec2 texCoord;
+out vec4 tint;
+
+// Two triangles, 0 1 2 and 0 2 3
+const int corners[6] = int[6](0, 1, 2, 0, 2, 3);
+
+vec2 Pick(vec4 first, vec4 second, int corner) {
+	return corner == 0 ? first.xy : corner == 1 ? first.zw : corner == 2 ? second.xy : second.zw;
+}
+
+void main() {
+	int corner = corners[gl_VertexID];
+	vec3 position = vec3(Pick(vertices01, vertices23, corner), 1.0);
+
+	texCoord = Pick(texCoords01, texCoords23, corner);
+	tint = color;
+	gl_Position = projection * vec4(dot(rowX, position), dot(rowY, position), dot(rowZ, position), 1.0);
+}
+)";
+
+	const char *FragmentSource = R"(#version 330 core
+in vec2 texCoord;
+in vec4 tint;
+
+uniform sampler2D image;
+
+out vec4 fragColor;
+
+void main() {
+	fragColor = texture(image, texCoord) * tint;
+}
+)";
+
+	const unsigned short QuadIndices[6] = { 0, 1, 2, 0, 2, 3 };
+
+	constexpr float DEG2RAD = 3.14159f / 180.0f;
+}
+
+void SpriteBatch::Init() {
+#if defined(SNOBASTE_GL)
+	const auto compile = [&](GLenum type, const char *source) {
+		auto shader = glCreateShader(type);
+		glShaderSource(shader, 1, &source, nullptr);
+		glCompileShader(shader);
+
+		GLint status = GL_FALSE;
+		glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+		if (status != GL_TRUE) {
+			char log[1024] = {};
+			glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+			logger.WriteDebug("Sprite shader failed to compile: ", log);
+		}
+
+		return shader;
+	};
+
+	auto vertexShader = compile(GL_VERTEX_SHADER, VertexSource);
+	auto fragmentShader = compile(GL_FRAGMENT_SHADER, FragmentSource);
+
+	program = glCreateProgram();
+	glAttachShader(program, vertexShader);
+	glAttachShader(program, fragmentShader);
+	glLinkProgram(program);
+	glDeleteShader(vertexShader);
+	glDeleteShader(fragmentShader);
+
+	GLint status = GL_FALSE;
+	glGetProgramiv(program, GL_LINK_STATUS, &status);
+	if (status != GL_TRUE) {
+		logger.WriteDebug("Sprite shader failed to link, drawing with client arrays");
+		glDeleteProgram(program);
+		program = 0;
+		return;
+	}
+
+	projectionLocation = glGetUniformLocation(program, "projection");
+	glUseProgram(program);
+	glUniform1i(glGetUniformLocation(program, "image"), 0);
+	glUniformMatrix4fv(projectionLocation, 1, GL_FALSE, projection.data());
+	glUseProgram(0);
+
+	// Every attribute advances once per sprite, the
+	// corner comes from gl_VertexID
+	glGenVertexArrays(1, &vertexArray);
+	glGenBuffers(1, &buffer);
+	glBindVertexArray(vertexArray);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+
+	const auto attribute = [](GLuint location, GLint size, std::size_t offset) {
+		glEnableVertexAttribArray(location);
+		glVertexAttribPointer(location, size, GL_FLOAT, GL_FALSE, sizeof(Instance), reinterpret_cast<const void *>(offset));
+		glVertexAttribDivisor(location, 1);
+	};
+	attribute(0, 4, offsetof(Instance, vertices));
+	attribute(1, 4, offsetof(Instance, vertices) + sizeof(float) * 4);
+	attribute(2, 4, offsetof(Instance, texCoords));
+	attribute(3, 4, offsetof(Instance, texCoords) + sizeof(float) * 4);
+	attribute(4, 4, offsetof(Instance, color));
+	attribute(5, 3, offsetof(Instance, x));
+	attribute(6, 3, offsetof(Instance, y));
+	attribute(7, 3, offsetof(Instance, z));
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+#endif
+}
+
+void SpriteBatch::Cleanup() {
+#if defined(SNOBASTE_GL)
+	if (program) {
+		glDeleteProgram(program);
+		glDeleteVertexArrays(1, &vertexArray);
+		glDeleteBuffers(1, &buffer);
+	}
+#endif
+
+	program = vertexArray = buffer = 0;
+	capacity = 0;
+	instances.clear();
+}
+
+void SpriteBatch::SetProjection(float width, float height) {
+	// Same as glOrtho(0, width, height, 0, -100, 100)
+	const float zNear = -100.0f, zFar = 100.0f;
+	projection = Identity;
+	projection[0] = 2.0f / width;
+	projection[5] = -2.0f / height;
+	projection[10] = -2.0f / (zFar - zNear);
+	projection[12] = -1.0f;
+	projection[13] = 1.0f;
+	projection[14] = -(zFar + zNear) / (zFar - zNear);
+
+	glMatrixMode(GL_PROJECTION);
+	glLoadMatrixf(projection.data());
+	glMatrixMode(GL_MODELVIEW);
+	LoadIdentity();
+
+#if defined(SNOBASTE_GL)
+	if (program) {
+		glUseProgram(program);
+		glUniformMatrix4fv(projectionLocation, 1, GL_FALSE, projection.data());
+		glUseProgram(0);
+	}
+#endif
+}
+
+void SpriteBatch::LoadIdentity() {
+	modelview = Identity;
+	glLoadIdentity();
+}
+
+void SpriteBatch::Translate(float x, float y, float z) {
+	auto matrix = Identity;
+	matrix[12] = x;
+	matrix[13] = y;
+	matrix[14] = z;
+	Multiply(matrix);
+
+	glTranslatef(x, y, z);
+}
+
+void SpriteBatch::Scale(float x, float y, float z) {
+	auto matrix = Identity;
+	matrix[0] = x;
+	matrix[5] = y;
+	matrix[10] = z;
+	Multiply(matrix);
+
+	glScalef(x, y, z);
+}
+
+void SpriteBatch::Rotate(float degrees, float x, float y, float z) {
+	// The rotation glRotatef builds, about a normalized axis
+	auto length = std::sqrt(x * x + y * y + z * z);
+	if (length > 0.0f) {
+		x /= length;
+		y /= length;
+		z /= length;
+
+		auto c = std::cos(degrees * DEG2RAD), s = std::sin(degrees * DEG2RAD), t = 1.0f - c;
+		Multiply({
+			x * x * t + c, y * x * t + z * s, x * z * t - y * s, 0,
+			x * y * t - z * s, y * y * t + c, y * z * t + x * s, 0,
+			x * z * t + y * s, y * z * t - x * s, z * z * t + c, 0,
+			0, 0, 0, 1
+		});
+	}
+
+	glRotatef(degrees, x, y, z);
+}
+
+void SpriteBatch::SetColor(float r, float g, float b, float a) {
+	color = { r, g, b, a };
+	glColor4f(r, g, b, a);
+}
+
+void SpriteBatch::Multiply(const Matrix &right) {
+	Matrix result;
+	for (int column = 0; column < 4; ++column) {
+		for (int row = 0; row < 4; ++row) {
+			float sum = 0.0f;
+			for (int i = 0; i < 4; ++i)
+				sum += modelview[i * 4 + row] * right[column * 4 + i];
+			result[column * 4 + row] = sum;
+		}
+	}
+
+	modelview = result;
+}
+
+void SpriteBatch::End() {
+	if (depth > 0 && --depth == 0)
+		Flush();
+}
+
+void SpriteBatch::Draw(GLuint texture, const float *vertices, const float *texCoords) {
+	if (!texture) return;
+
+	if (!program) {
+		DrawFixed(texture, vertices, texCoords);
+		return;
+	}
+
+	if (texture != this->texture)
+		Flush();
+	this->texture = texture;
+
+	Instance instance;
+	std::memcpy(instance.vertices, vertices, sizeof(instance.vertices));
+	std::memcpy(instance.texCoords, texCoords, sizeof(instance.texCoords));
+	std::memcpy(instance.color, color.data(), sizeof(instance.color));
+	for (int row = 0; row < 3; ++row) {
+		auto &target = row == 0 ? instance.x : row == 1 ? instance.y : instance.z;
+		target[0] = modelview[row];
+		target[1] = modelview[4 + row];
+		target[2] = modelview[12 + row];
+	}
+	instances.emplace_back(instance);
+
+	if (!depth)
+		Flush();
+}
+
+void SpriteBatch::Flush() {
+#if defined(SNOBASTE_GL)
+	if (instances.empty()) return;
+
+	glUseProgram(program);
+
+	// Orphan the old contents rather than wait on them
+	auto size = instances.size() * sizeof(Instance);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	if (size > capacity)
+		capacity = size * 2;
+	glBufferData(GL_ARRAY_BUFFER, capacity, nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, size, instances.data());
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glBindVertexArray(vertexArray);
+	glDrawArraysInstanced(GL_TRIANGLES, 0, 6, static_cast<GLsizei>(instances.size()));
+	++drawCalls;
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glUseProgram(0);
+
+	instances.clear();
+#endif
+}
+
+void SpriteBatch::DrawFixed(GLuint texture, const float *vertices, const float *texCoords) {
+	glEnable(GL_TEXTURE_2D);
+	glBindTexture(GL_TEXTURE_2D, texture);
+
+	glVertexPointer(2, GL_FLOAT, 0, vertices);
+	glTexCoordPointer(2, GL_FLOAT, 0, texCoords);
+
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_TEXTURE_COORD_ARRAY);
+	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, QuadIndices);
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glDisableClientState(GL_TEXTURE_COORD_ARRAY);
+
+	glDisable(GL_TEXTURE_2D);
+	++drawCalls;
+}
\ No newline at end of file
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include "glad/glad.h"
+
+#include "Filesystem/FileRepository.hpp"
+
+using namespace SnobasteCPP;
+
+// Draws textured quads through one shader, with an instanced draw
+// per run of sprites sharing a texture. Each sprite takes the
+// transform and colour set here, which are kept on the CPU rather
+// than read back from GL. Every change is mirrored into the
+// fixed-function state for fonts and client array draws.
+//
+// Outside Begin and End a sprite is drawn right away. Inside them
+// sprites are held until the texture changes or End, so only wrap
+// runs with nothing else drawn in between.
+class SpriteBatch : public LoggableClass {
+public:
+	void Init();
+	void Cleanup();
+
+	// Top-left origin ortho projection for a window, set
+	// on the shader once rather than every flush
+	void SetProjection(float width, float height);
+
+	void LoadIdentity();
+	void Translate(float x, float y, float z = 0.0f);
+	void Scale(float x, float y, float z = 1.0f);
+	void Rotate(float degrees, float x, float y, float z);
+	void SetColor(float r, float g, float b, float a);
+
+	// Column major, like GL
+	const float *GetProjection() const { return projection.data(); }
+	const float *GetModelview() const { return modelview.data(); }
+	const float *GetColor() const { return color.data(); }
+
+	// Scopes nest, the outermost End flushes
+	void Begin() { ++depth; }
+	void End();
+
+	// Draws whatever is held, before something is drawn
+	// some other way inside a scope
+	void Flush();
+
+	// Draws a quad given as four corners and their texture
+	// coordinates, in the order the renderer's index buffer uses
+	void Draw(GLuint texture, const float *vertices, const float *texCoords);
+
+	// Instanced draw calls since the last call
+	std::size_t TakeDrawCalls() {
+		auto calls = drawCalls;
+		drawCalls = 0;
+		return calls;
+	}
+
+private:
+	struct Instance {
+		float vertices[8];
+		float texCoords[8];
+		float color[4];
+
+		// Rows of the modelview for a point on the z = 0 plane
+		float x[3], y[3], z[3];
+	};
+
+	using Matrix = std::array<float, 16>;
+
+	// Client arrays, for contexts without the shader
+	void DrawFixed(GLuint texture, const float *vertices, const float *texCoords);
+
+	// Post-multiplies the modelview, as the GL calls do
+	void Multiply(const Matrix &right);
+
+	static constexpr Matrix Identity = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+
+	Matrix projection = Identity;
+	Matrix modelview = Identity;
+	std::array<float, 4> color = { 1.0f, 1.0f, 1.0f, 1.0f };
+
+	GLuint program = 0;
+	GLint projectionLocation = -1;
+	GLuint vertexArray = 0;
+	GLuint buffer = 0;
+	std::size_t capacity = 0;
+
+	std::vector<Instance> instances;
+	GLuint texture = 0;
+	int depth = 0;
+
+	std::size_t drawCalls = 0;
+};
\ No newline at end of file
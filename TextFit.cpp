@@ -0,0 +1,49 @@
+#include "TextFit.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+#include "Defines.hpp"
+
+float TextFit::Solve(std::size_t key, const std::function<float()> &estimate, const std::function<bool(float)> &fits) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (auto iter = results.find(key); iter != results.end())
+			return iter->second;
+	}
+
+	const auto scale = [](int step) { return 1.0f - step * FontScaleDelta; };
+
+	// The answer is in [low, high], the last step counts as fitting
+	const int last = static_cast<int>(std::lround(1.0f / FontScaleDelta)) - 1;
+	int low = 0, high = last;
+	const auto probe = [&](int step) {
+		if (step < low || step >= high) return;
+
+		if (fits(scale(step)))
+			high = step;
+		else
+			low = step + 1;
+	};
+
+	// Linear scaling usually lands on the answer or next to it
+	auto linear = std::clamp(estimate(), 0.0f, 1.0f);
+	auto guess = std::clamp(static_cast<int>(std::ceil((1.0f - linear) / FontScaleDelta - 0.001f)), 0, last);
+	probe(guess);
+	probe(high == guess ? guess - 1 : guess + 1);
+
+	while (low < high)
+		probe((low + high) / 2);
+
+	std::lock_guard<std::mutex> lock(mutex);
+	if (results.size() >= MaxResults)
+		results.clear();
+	results[key] = scale(high);
+
+	return scale(high);
+}
+
+void TextFit::Clear() {
+	std::lock_guard<std::mutex> lock(mutex);
+	results.clear();
+}
\ No newline at end of file
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <functional>
+#include <mutex>
+#include <unordered_map>
+
+// Finds the largest font scale, stepping down from 1 by FontScaleDelta,
+// at which text fits its box. Rather than trying every step in turn it
+// starts from a linear estimate and binary searches from there, and
+// remembers each answer.
+class TextFit {
+public:
+	// Answers remembered before they are all thrown out
+	static constexpr std::size_t MaxResults = 256;
+
+	// fits is asked whether the text fits at a scale, and must only
+	// go from false to true as the scale shrinks. estimate is asked
+	// for the scale at which the text, measured at 1, would fit if it
+	// shrank linearly. The smallest step is used if nothing fits.
+	float Solve(std::size_t key, const std::function<float()> &estimate, const std::function<bool(float)> &fits);
+
+	void Clear();
+
+	// Combines whatever a fit depends on into a key
+	template <typename... Args>
+	static std::size_t Key(const Args &...args) {
+		std::size_t seed = 0;
+		((seed ^= std::hash<Args>()(args) + 0x9e3779b9 + (seed << 6) + (seed >> 2)), ...);
+		return seed;
+	}
+
+private:
+	std::mutex mutex;
+	std::unordered_map<std::size_t, float> results;
+};
\ No newline at end of file
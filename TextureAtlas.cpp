@@ -0,0 +1,153 @@
+#include "TextureAtlas.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+std::vector<Book::Page::Image *> TextureAtlas::Build(TextureRegistry &registry, uint32_t maxSize) {
+	std::vector<Book::Page::Image *> packable, standalone;
+	std::size_t area = 0;
+	uint32_t widest = 0;
+	for (auto image : queued) {
+		if (!image->GetRGBA() || image->width + Padding * 2 > maxSize || image->height + Padding * 2 > maxSize) {
+			standalone.emplace_back(image);
+			continue;
+		}
+
+		packable.emplace_back(image);
+		area += static_cast<std::size_t>(image->width + Padding * 2) * (image->height + Padding * 2);
+		widest = std::max(widest, image->width + Padding * 2);
+	}
+	queued.clear();
+
+	if (packable.empty())
+		return standalone;
+
+	// Tallest first keeps shelves tight
+	std::stable_sort(packable.begin(), packable.end(), [](const auto *a, const auto *b) {
+		return a->height > b->height;
+	});
+
+	uint32_t atlasWidth = 1;
+	while (atlasWidth < std::max<std::size_t>(widest, static_cast<std::size_t>(std::ceil(std::sqrt(static_cast<double>(area))))))
+		atlasWidth <<= 1;
+	atlasWidth = std::min(atlasWidth, maxSize);
+
+	// Shelf pack, starting a new atlas when one fills up
+	struct Placement {
+		Book::Page::Image *image;
+		uint32_t atlas, x, y;
+	};
+	std::vector<Placement> placements;
+	std::vector<uint32_t> atlasHeights{ 0 };
+	uint32_t shelfX = 0, shelfY = 0, shelfHeight = 0;
+	for (auto image : packable) {
+		auto width = image->width + Padding * 2;
+		auto height = image->height + Padding * 2;
+
+		if (shelfX + width > atlasWidth) {
+			shelfX = 0;
+			shelfY += shelfHeight;
+			shelfHeight = 0;
+		}
+
+		if (shelfY + height > maxSize) {
+			atlasHeights.emplace_back(0);
+			shelfX = shelfY = shelfHeight = 0;
+		}
+
+		placements.emplace_back(Placement{ image, static_cast<uint32_t>(atlasHeights.size() - 1), shelfX, shelfY });
+		shelfX += width;
+		shelfHeight = std::max(shelfHeight, height);
+		atlasHeights.back() = std::max(atlasHeights.back(), shelfY + shelfHeight);
+	}
+
+	glEnable(GL_TEXTURE_2D);
+	for (uint32_t atlas = 0; atlas < atlasHeights.size(); ++atlas) {
+		auto atlasHeight = atlasHeights[atlas];
+		std::vector<uint8_t> pixels(static_cast<std::size_t>(atlasWidth) * atlasHeight * 4);
+
+		for (const auto &placement : placements) {
+			if (placement.atlas == atlas)
+				Blit(*placement.image, pixels.data(), atlasWidth, placement.x, placement.y);
+		}
+
+		GLuint textureId;
+		glGenTextures(1, &textureId);
+
+		glBindTexture(GL_TEXTURE_2D, textureId);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, GL_FALSE);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, atlasWidth, atlasHeight, 0, GL_RGBA,
+			GL_UNSIGNED_BYTE, pixels.data());
+
+		auto atlasHandle = registry.Acquire("Atlas/" + std::to_string(atlasCount++));
+		registry.Set(atlasHandle, textureId, pixels.size());
+		registry.Pin(atlasHandle);
+
+		for (const auto &placement : placements) {
+			if (placement.atlas != atlas) continue;
+
+			auto &image = *placement.image;
+
+			TextureRegistry::Region region;
+			region.atlas = atlasHandle;
+			region.x = placement.x + Padding;
+			region.y = placement.y + Padding;
+			region.width = image.width;
+			region.height = image.height;
+			region.u0 = region.x / static_cast<float>(atlasWidth);
+			region.v0 = region.y / static_cast<float>(atlasHeight);
+			region.u1 = (region.x + region.width) / static_cast<float>(atlasWidth);
+			region.v1 = (region.y + region.height) / static_cast<float>(atlasHeight);
+
+			image.texture = registry.Acquire(image.relativePath);
+			registry.SetRegion(image.texture, region);
+
+			image.ReleasePixels();
+		}
+
+		logger.WriteDebug("Packed atlas ", atlas, " at ", atlasWidth, "x", atlasHeight);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glDisable(GL_TEXTURE_2D);
+
+	return standalone;
+}
+
+bool TextureAtlas::Replace(const TextureRegistry &registry, TextureRegistry::Handle handle, const Book::Page::Image &image) {
+	auto region = registry.GetRegion(handle);
+	if (!region || region->width != image.width || region->height != image.height || !image.GetRGBA())
+		return false;
+
+	auto width = image.width + Padding * 2;
+	auto height = image.height + Padding * 2;
+	std::vector<uint8_t> pixels(static_cast<std::size_t>(width) * height * 4);
+	Blit(image, pixels.data(), width, 0, 0);
+
+	glBindTexture(GL_TEXTURE_2D, registry.Get(handle));
+	glTexSubImage2D(GL_TEXTURE_2D, 0, region->x - Padding, region->y - Padding, width, height, GL_RGBA,
+		GL_UNSIGNED_BYTE, pixels.data());
+
+	return true;
+}
+
+void TextureAtlas::Blit(const Book::Page::Image &image, uint8_t *target, uint32_t targetWidth, uint32_t x, uint32_t y) {
+	const auto rowBytes = static_cast<std::size_t>(image.width) * 4;
+	const auto *pixels = image.GetRGBA();
+
+	for (uint32_t row = 0; row < image.height + Padding * 2; ++row) {
+		auto sourceRow = std::clamp<int64_t>(static_cast<int64_t>(row) - Padding, 0, image.height - 1);
+		const auto *source = pixels + sourceRow * rowBytes;
+		auto *destination = &target[((static_cast<std::size_t>(y) + row) * targetWidth + x) * 4];
+
+		for (uint32_t pad = 0; pad < Padding; ++pad) {
+			std::memcpy(destination + pad * 4, source, 4);
+			std::memcpy(destination + (Padding + image.width + pad) * 4, source + rowBytes - 4, 4);
+		}
+		std::memcpy(destination + Padding * 4, source, rowBytes);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "Book.hpp"
+#include "TextureRegistry.hpp"
+
+using namespace SnobasteCPP;
+
+// Packs the fixed UI images (book chrome, page overlays, the curl
+// shadow and the menu chip) into as few textures as will fit, so a
+// spread draws from one texture instead of rebinding per image.
+class TextureAtlas : public LoggableClass {
+public:
+	// Edge pixels are repeated this far around each image so linear
+	// filtering never samples a neighbour
+	static constexpr uint32_t Padding = 2;
+
+	// Queues a decoded image, which must outlive Build
+	void Add(Book::Page::Image &image) { queued.emplace_back(&image); }
+
+	// Uploads queued images into atlases no larger than maxSize and
+	// registers each image as a region of one. Frees the decoded
+	// pixels of everything packed and returns the images too large
+	// to share a texture.
+	std::vector<Book::Page::Image *> Build(TextureRegistry &registry, uint32_t maxSize);
+
+	// Rewrites a region in place after its file changed. Returns
+	// false if the new image is a different size.
+	static bool Replace(const TextureRegistry &registry, TextureRegistry::Handle handle, const Book::Page::Image &image);
+
+private:
+	// Copies image into target at x, y with its edges extended
+	// into the padding around it
+	static void Blit(const Book::Page::Image &image, uint8_t *target, uint32_t targetWidth, uint32_t x, uint32_t y);
+
+	std::vector<Book::Page::Image *> queued;
+	uint32_t atlasCount = 0;
+};
\ No newline at end of file
@@ -0,0 +1,98 @@
+#include "TextureRegistry.hpp"
+
+#include <algorithm>
+
+TextureRegistry::Handle TextureRegistry::Acquire(const std::string &path) {
+	if (auto handle = Find(path); handle != None)
+		return handle;
+
+	auto handle = static_cast<Handle>(slots.size());
+	slots.emplace_back();
+	slots.back().path = path;
+	handles.emplace(
+		std::make_pair(
+			path,
+			handle
+		)
+	);
+
+	return handle;
+}
+
+void TextureRegistry::Set(Handle handle, GLuint texture, std::size_t bytes) {
+	if (handle == None || handle >= slots.size()) return;
+
+	auto &slot = slots[handle];
+	if (slot.texture && slot.texture != texture)
+		Release(handle);
+
+	// Moving out of an atlas
+	slot.region = Region();
+
+	if (!slot.texture)
+		++stats.count;
+	else
+		stats.bytes -= slot.bytes;
+
+	slot.texture = texture;
+	slot.bytes = bytes;
+	slot.lastUse = frame;
+	slot.evicted = false;
+	stats.bytes += bytes;
+}
+
+void TextureRegistry::SetRegion(Handle handle, const Region &region) {
+	if (handle == None || handle >= slots.size() || region.atlas == handle) return;
+
+	Release(handle);
+	slots[handle].region = region;
+}
+
+void TextureRegistry::Release(Handle handle) {
+	if (handle == None || handle >= slots.size()) return;
+
+	auto &slot = slots[handle];
+	slot.region = Region();
+	slot.evicted = false;
+	if (!slot.texture) return;
+
+	glDeleteTextures(1, &slot.texture);
+
+	--stats.count;
+	stats.bytes -= slot.bytes;
+	slot.texture = 0;
+	slot.bytes = 0;
+}
+
+void TextureRegistry::ReleaseAll() {
+	for (Handle handle = 1; handle < slots.size(); ++handle)
+		Release(handle);
+}
+
+void TextureRegistry::Evict(Handle handle) {
+	if (handle == None || handle >= slots.size()) return;
+
+	Release(handle);
+	slots[handle].evicted = true;
+	++stats.evictions;
+}
+
+void TextureRegistry::Trim() {
+	if (!stats.budget || stats.bytes <= stats.budget) return;
+
+	std::vector<Handle> candidates;
+	for (Handle handle = 1; handle < slots.size(); ++handle) {
+		const auto &slot = slots[handle];
+		if (slot.texture && !slot.pinned && slot.lastUse + 1 < frame)
+			candidates.emplace_back(handle);
+	}
+
+	std::sort(candidates.begin(), candidates.end(), [&](auto left, auto right) {
+		return slots[left].lastUse < slots[right].lastUse;
+	});
+
+	for (auto handle : candidates) {
+		if (stats.bytes <= stats.budget) break;
+		Evict(handle);
+	}
+}
\ No newline at end of file
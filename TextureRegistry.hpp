@@ -0,0 +1,127 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "glad/glad.h"
+
+// Hands out a stable integer handle per image path so draws can
+// index a flat table instead of looking textures up by name. A
+// handle outlives its GL texture: releasing clears the slot and the
+// next upload for the same path fills it again.
+//
+// Textures are also kept under a memory budget. Each draw stamps its
+// slot with the frame, and Trim evicts the least recently drawn ones
+// until the total fits again. An evicted slot remembers that it was
+// resident, so the renderer can bring it back when it's next drawn.
+class TextureRegistry {
+public:
+	using Handle = uint32_t;
+	static constexpr Handle None = 0;
+
+	struct Stats {
+		std::size_t count = 0;
+		std::size_t bytes = 0;
+
+		// Zero is unlimited
+		std::size_t budget = 0;
+		std::size_t evictions = 0;
+	};
+
+	// Where an image lives inside an atlas texture
+	struct Region {
+		Handle atlas = None;
+		uint32_t x = 0, y = 0;
+		uint32_t width = 0, height = 0;
+		float u0 = 0.0f, v0 = 0.0f, u1 = 1.0f, v1 = 1.0f;
+	};
+
+	// Returns the handle for path, creating an empty slot if needed
+	Handle Acquire(const std::string &path);
+
+	// Returns the handle for path, or None if it was never acquired
+	Handle Find(const std::string &path) const {
+		auto iter = handles.find(path);
+		return iter != handles.end() ? iter->second : None;
+	}
+
+	// Stores an uploaded texture in handle's slot
+	void Set(Handle handle, GLuint texture, std::size_t bytes);
+
+	// Points handle at part of the atlas texture in another slot
+	void SetRegion(Handle handle, const Region &region);
+
+	// The atlas region handle draws from, or nullptr if it has
+	// a texture of its own
+	const Region *GetRegion(Handle handle) const {
+		return handle < slots.size() && slots[handle].region.atlas != None ? &slots[handle].region : nullptr;
+	}
+
+	// Deletes the texture behind handle, keeping the handle.
+	// Regions are only unlinked, their atlas stays.
+	void Release(Handle handle);
+	void Release(const std::string &path) { Release(Find(path)); }
+
+	// Deletes every texture. Handles stay valid, so images
+	// never end up pointing at another path's slot.
+	void ReleaseAll();
+
+	// Releases handle's texture to make room, flagging it to be
+	// loaded again on demand
+	void Evict(Handle handle);
+	bool IsEvicted(Handle handle) const { return handle < slots.size() && slots[handle].evicted; }
+
+	// Pinned textures are never evicted, for ones nothing
+	// could load again
+	void Pin(Handle handle) {
+		if (handle != None && handle < slots.size())
+			slots[handle].pinned = true;
+	}
+
+	// Marks handle as drawn this frame
+	void Touch(Handle handle) {
+		if (handle < slots.size())
+			slots[handle].lastUse = frame;
+	}
+	void NextFrame() { ++frame; }
+
+	void SetBudget(std::size_t bytes) { stats.budget = bytes; }
+
+	// Evicts the least recently drawn textures until the total is
+	// within budget. Anything drawn this frame or the last stays.
+	void Trim();
+
+	const std::string &GetPath(Handle handle) const {
+		static const std::string none;
+		return handle < slots.size() ? slots[handle].path : none;
+	}
+
+	GLuint Get(Handle handle) const {
+		if (handle >= slots.size()) return 0;
+
+		const auto &slot = slots[handle];
+		return slot.region.atlas != None ? slots[slot.region.atlas].texture : slot.texture;
+	}
+	bool IsResident(Handle handle) const { return Get(handle) != 0; }
+
+	const Stats &GetStats() const { return stats; }
+
+private:
+	struct Slot {
+		GLuint texture = 0;
+		std::size_t bytes = 0;
+		Region region;
+
+		std::string path;
+		uint64_t lastUse = 0;
+		bool pinned = false;
+		bool evicted = false;
+	};
+
+	// Slot 0 stays empty so None always resolves to no texture
+	std::vector<Slot> slots{ 1 };
+	std::map<std::string, Handle> handles;
+	Stats stats;
+	uint64_t frame = 0;
+};
\ No newline at end of file
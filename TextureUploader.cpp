@@ -0,0 +1,345 @@
+#include "TextureUploader.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+void TextureUploader::Init(LoaderContext *loader) {
+	// The ring is only needed to upload on the render thread
+	if (loader && loader->IsAvailable()) {
+		this->loader = loader;
+	} else {
+#if defined(SNOBASTE_GL)
+		for (auto &buffer : ring) {
+			glGenBuffers(1, &buffer.buffer);
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer.buffer);
+			glBufferData(GL_PIXEL_UNPACK_BUFFER, BufferSize, nullptr, GL_STREAM_DRAW);
+		}
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+#endif
+	}
+
+	// Blank paper until the image lands
+	const uint8_t pixel[4] = { 232, 226, 214, 255 };
+
+	glEnable(GL_TEXTURE_2D);
+	glGenTextures(1, &placeholder);
+	glBindTexture(GL_TEXTURE_2D, placeholder);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixel);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glDisable(GL_TEXTURE_2D);
+}
+
+void TextureUploader::Cleanup() {
+	for (auto &job : jobs) {
+		if (job.texture)
+			glDeleteTextures(1, &job.texture);
+		if (job.transfer && !job.transfer->busy && job.transfer->texture)
+			glDeleteTextures(1, &job.transfer->texture);
+	}
+	jobs.clear();
+
+#if defined(SNOBASTE_GL)
+	for (auto &buffer : ring) {
+		if (buffer.fence)
+			glDeleteSync(buffer.fence);
+		if (buffer.buffer)
+			glDeleteBuffers(1, &buffer.buffer);
+		buffer = Buffer();
+	}
+#endif
+
+	glDeleteTextures(1, &placeholder);
+	placeholder = 0;
+}
+
+void TextureUploader::Queue(TextureRegistry::Handle handle, Book::Page::Image &image) {
+	if (handle == TextureRegistry::None || !image.HasPixels() || !image.width || !image.height) return;
+
+	Cancel(handle);
+
+	Job job;
+	job.handle = handle;
+	if (!image.upload.levels.empty()) {
+		job.upload = std::move(image.upload);
+	} else {
+		// Decoded pixels are a single RGBA8 level
+		auto size = image.data.size();
+		job.upload.format = ImagePipeline::TextureData::RGBA8;
+		job.upload.levels.emplace_back(ImagePipeline::TextureData::Level{ image.width, image.height, 0, size });
+		job.upload.storage = std::move(image.data);
+	}
+	image.ReleasePixels();
+
+	jobs.emplace_back(std::move(job));
+}
+
+void TextureUploader::Prioritize(TextureRegistry::Handle handle) {
+	auto job = Find(handle);
+	if (job == jobs.end() || job == jobs.begin()) return;
+
+	// The front job may be partly written, keep it going
+	auto moved = std::move(jobs[job - jobs.begin()]);
+	jobs.erase(job);
+	jobs.emplace(jobs.begin() + (jobs.front().texture || jobs.front().transfer ? 1 : 0), std::move(moved));
+}
+
+void TextureUploader::Cancel(TextureRegistry::Handle handle) {
+	auto job = Find(handle);
+	if (job == jobs.end()) return;
+
+	if (job->texture)
+		glDeleteTextures(1, &job->texture);
+
+	// A busy transfer's texture goes once its bands are written
+	if (job->transfer && !job->transfer->busy && job->transfer->texture)
+		glDeleteTextures(1, &job->transfer->texture);
+	jobs.erase(job);
+}
+
+std::size_t TextureUploader::GetQueuedBytes() const {
+	std::size_t bytes = 0;
+	for (const auto &job : jobs)
+		bytes += job.transfer ? job.transfer->size : job.upload.Size();
+
+	return bytes;
+}
+
+std::vector<TextureRegistry::Handle> TextureUploader::Trim(std::size_t budget) {
+	std::vector<TextureRegistry::Handle> dropped;
+
+	// Anything already started is left to finish
+	auto bytes = GetQueuedBytes();
+	while (bytes > budget && !jobs.empty() && !jobs.back().texture && !jobs.back().transfer) {
+		bytes -= jobs.back().upload.Size();
+		dropped.emplace_back(jobs.back().handle);
+		jobs.pop_back();
+	}
+
+	return dropped;
+}
+
+void TextureUploader::Pump(TextureRegistry &registry) {
+	if (jobs.empty()) return;
+
+	if (loader) {
+		Submit(registry);
+		return;
+	}
+
+	glEnable(GL_TEXTURE_2D);
+
+	std::size_t spent = 0;
+	while (!jobs.empty() && spent < FrameBudget) {
+		auto &job = jobs.front();
+		const auto &upload = job.upload;
+
+		if (!job.texture)
+			job.texture = Create(upload);
+		else
+			glBindTexture(GL_TEXTURE_2D, job.texture);
+
+#if defined(SNOBASTE_GL)
+		// Bands too large for a buffer go straight from memory
+		if (!IsFree()) break;
+		auto room = std::min(BufferSize, FrameBudget - spent);
+#else
+		auto room = FrameBudget - spent;
+#endif
+		auto band = NextBand(upload, job.level, job.row, room);
+		auto source = GetSource(upload, band);
+
+		const void *pixels = source;
+#if defined(SNOBASTE_GL)
+		bool buffered = false;
+		if (band.size <= BufferSize) {
+			if (auto target = Map(band.size)) {
+				std::memcpy(target, source, band.size);
+				glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+				// Now an offset into the bound buffer
+				pixels = nullptr;
+				buffered = true;
+			}
+		}
+#endif
+
+		Write(upload, band, pixels);
+
+#if defined(SNOBASTE_GL)
+		if (buffered)
+			Fence();
+#endif
+
+		spent += band.size;
+		if (job.level == upload.levels.size()) {
+			registry.Set(job.handle, job.texture, upload.Size());
+			jobs.pop_front();
+		}
+	}
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glDisable(GL_TEXTURE_2D);
+}
+
+GLuint TextureUploader::Create(const ImagePipeline::TextureData &upload) {
+	GLuint texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, upload.levels.size() > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_GENERATE_MIPMAP, GL_FALSE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, static_cast<GLint>(upload.levels.size() - 1));
+
+	// Without pixels this only allocates, which works
+	// for compressed formats on desktop GL too
+	for (std::size_t i = 0; i < upload.levels.size(); ++i) {
+		const auto &level = upload.levels[i];
+		glTexImage2D(GL_TEXTURE_2D, static_cast<GLint>(i), upload.IsCompressed() ? upload.format : GL_RGBA,
+			level.width, level.height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	}
+
+	return texture;
+}
+
+TextureUploader::Band TextureUploader::NextBand(const ImagePipeline::TextureData &upload, std::size_t &level, uint32_t &row, std::size_t room) {
+	// S3TC goes in whole rows of 4x4 blocks
+	const auto &size = upload.levels[level];
+	const uint32_t rowStep = upload.IsCompressed() ? 4 : 1;
+	const auto bandSize = ImagePipeline::TextureData::GetLevelSize(upload.format, size.width, rowStep);
+
+	Band band;
+	band.level = level;
+	band.row = row;
+	band.rows = std::min<uint32_t>(size.height - row, static_cast<uint32_t>(std::max<std::size_t>(room / bandSize, 1) * rowStep));
+	band.size = ImagePipeline::TextureData::GetLevelSize(upload.format, size.width, band.rows);
+
+	row += band.rows;
+	if (row >= size.height) {
+		row = 0;
+		++level;
+	}
+
+	return band;
+}
+
+void TextureUploader::Write(const ImagePipeline::TextureData &upload, const Band &band, const void *pixels) {
+	const auto &level = upload.levels[band.level];
+
+	if (upload.IsCompressed()) {
+		glCompressedTexSubImage2D(GL_TEXTURE_2D, static_cast<GLint>(band.level), 0, band.row, level.width, band.rows, upload.format,
+			static_cast<GLsizei>(band.size), pixels);
+	} else {
+		glTexSubImage2D(GL_TEXTURE_2D, static_cast<GLint>(band.level), 0, band.row, level.width, band.rows, GL_RGBA,
+			GL_UNSIGNED_BYTE, pixels);
+	}
+}
+
+const uint8_t *TextureUploader::GetSource(const ImagePipeline::TextureData &upload, const Band &band) {
+	return upload.GetLevel(band.level) + ImagePipeline::TextureData::GetLevelSize(upload.format, upload.levels[band.level].width, band.row);
+}
+
+void TextureUploader::Submit(TextureRegistry &registry) {
+	auto started = static_cast<std::size_t>(std::count_if(jobs.begin(), jobs.end(), [](const auto &job) { return job.transfer != nullptr; }));
+
+	// The same budget as the ring, spread over the
+	// images in flight in queue order
+	std::size_t spent = 0;
+	for (auto &job : jobs) {
+		if (spent >= FrameBudget) return;
+
+		if (!job.transfer) {
+			if (started >= MaxInFlight) continue;
+
+			job.transfer = std::make_shared<Transfer>();
+			job.transfer->size = job.upload.Size();
+			job.transfer->upload = std::move(job.upload);
+			++started;
+		}
+
+		auto transfer = job.transfer;
+		if (transfer->busy) continue;
+
+		std::vector<Band> bands;
+		while (spent < FrameBudget && transfer->level < transfer->upload.levels.size()) {
+			bands.emplace_back(NextBand(transfer->upload, transfer->level, transfer->row, FrameBudget - spent));
+			spent += bands.back().size;
+		}
+		transfer->busy = true;
+
+		loader->Submit(
+			[transfer, bands = std::move(bands)] {
+				if (!transfer->texture)
+					transfer->texture = Create(transfer->upload);
+				else
+					glBindTexture(GL_TEXTURE_2D, transfer->texture);
+
+				for (const auto &band : bands)
+					Write(transfer->upload, band, GetSource(transfer->upload, band));
+				glBindTexture(GL_TEXTURE_2D, 0);
+			},
+			[this, transfer, &registry](bool succeeded) {
+				transfer->busy = false;
+				Finish(registry, transfer, succeeded);
+			}
+		);
+	}
+}
+
+void TextureUploader::Finish(TextureRegistry &registry, const std::shared_ptr<Transfer> &transfer, bool succeeded) {
+	auto job = std::find_if(jobs.begin(), jobs.end(), [&](const auto &job) { return job.transfer == transfer; });
+
+	// Cancelled or replaced while it was loading. A failed
+	// upload is dropped for the residency pass to ask again.
+	if (job == jobs.end() || !succeeded) {
+		if (transfer->texture)
+			glDeleteTextures(1, &transfer->texture);
+		if (job != jobs.end()) {
+			logger.WriteDebug("Unable to upload a texture, dropping it");
+			jobs.erase(job);
+		}
+		return;
+	}
+
+	// More bands to go next frame
+	if (transfer->level < transfer->upload.levels.size()) return;
+
+	registry.Set(job->handle, transfer->texture, transfer->size);
+	jobs.erase(job);
+}
+
+#if defined(SNOBASTE_GL)
+bool TextureUploader::IsFree() {
+	auto &buffer = ring[next];
+	if (!buffer.fence) return true;
+
+	if (glClientWaitSync(buffer.fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+		return false;
+
+	glDeleteSync(buffer.fence);
+	buffer.fence = nullptr;
+	return true;
+}
+
+uint8_t *TextureUploader::Map(std::size_t size) {
+	// Nothing is reading the buffer anymore, so skip
+	// the driver's own synchronization
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, ring[next].buffer);
+	auto target = static_cast<uint8_t *>(glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, size,
+		GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT));
+	if (!target)
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+	return target;
+}
+
+void TextureUploader::Fence() {
+	ring[next].fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	next = (next + 1) % ring.size();
+
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+#endif
\ No newline at end of file
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <deque>
+
+#include "Book.hpp"
+#include "LoaderContext.hpp"
+#include "TextureRegistry.hpp"
+
+using namespace SnobasteCPP;
+
+// Streams texture uploads in row bands, at most FrameBudget bytes
+// a frame so loading a book never stalls one.
+//
+// With a loader context, each frame's bands for the first few images
+// are written there, one batch per image in flight so the queue order
+// still counts. Without one, they go through a ring of pixel buffer
+// objects on the render thread. Each buffer is fenced when its copy is
+// issued and only refilled once the GPU has consumed it, so a band
+// larger than a buffer goes straight from memory.
+class TextureUploader : public LoggableClass {
+public:
+	static constexpr std::size_t RingSize = 3;
+	static constexpr std::size_t BufferSize = 4 * 1024 * 1024;
+
+	// About two 1080p page images
+	static constexpr std::size_t FrameBudget = 8 * 1024 * 1024;
+
+	// Images being written on the loader context at once
+	static constexpr std::size_t MaxInFlight = 2;
+
+	void Init(LoaderContext *loader = nullptr);
+	void Cleanup();
+
+	// Takes image's pixels for handle, replacing anything still
+	// queued for it. The image keeps its dimensions.
+	void Queue(TextureRegistry::Handle handle, Book::Page::Image &image);
+
+	// Moves handle's upload to the front of the queue
+	void Prioritize(TextureRegistry::Handle handle);
+
+	// Drops handle's upload and whatever of it was written
+	void Cancel(TextureRegistry::Handle handle);
+
+	bool IsQueued(TextureRegistry::Handle handle) const { return handle != TextureRegistry::None && Find(handle) != jobs.end(); }
+	bool IsEmpty() const { return jobs.empty(); }
+
+	// Spends this frame's budget on the queue, registering each
+	// texture once its last level is written. Render thread only.
+	void Pump(TextureRegistry &registry);
+
+	// Pixels held for queued images
+	std::size_t GetQueuedBytes() const;
+
+	// Drops queued images from the back, the ones furthest from
+	// being drawn, until what's held fits in budget. Returns their
+	// handles so they can be loaded again on demand.
+	std::vector<TextureRegistry::Handle> Trim(std::size_t budget);
+
+	// Drawn in place of images that are still queued
+	GLuint GetPlaceholder() const { return placeholder; }
+
+private:
+	// Rows of one level, at most a budget's worth
+	struct Band {
+		std::size_t level = 0;
+		uint32_t row = 0;
+		uint32_t rows = 0;
+		std::size_t size = 0;
+	};
+
+	// A job's pixels on their way through the loader context.
+	// Bands are handed out on the render thread, so level and
+	// row are where the next one starts.
+	struct Transfer {
+		ImagePipeline::TextureData upload;
+		std::size_t size = 0;
+		GLuint texture = 0;
+
+		std::size_t level = 0;
+		uint32_t row = 0;
+
+		// Whether the loader still has bands of it to write
+		bool busy = false;
+	};
+
+	struct Job {
+		TextureRegistry::Handle handle = TextureRegistry::None;
+		ImagePipeline::TextureData upload;
+
+		// Allocated with every level on the first band
+		GLuint texture = 0;
+		std::size_t level = 0;
+		uint32_t row = 0;
+
+		// Set once the job is handed to the loader context
+		std::shared_ptr<Transfer> transfer;
+	};
+
+	std::deque<Job>::const_iterator Find(TextureRegistry::Handle handle) const {
+		return std::find_if(jobs.begin(), jobs.end(), [handle](const auto &job) { return job.handle == handle; });
+	}
+
+	// Creates a texture for every level of upload, left
+	// for the bands to fill in
+	static GLuint Create(const ImagePipeline::TextureData &upload);
+
+	// The band from level and row that fits in room, or one
+	// row of blocks if nothing does. Moves them past it.
+	static Band NextBand(const ImagePipeline::TextureData &upload, std::size_t &level, uint32_t &row, std::size_t room);
+	// Writes band into the bound texture from pixels, which
+	// is an offset if a pixel buffer is bound
+	static void Write(const ImagePipeline::TextureData &upload, const Band &band, const void *pixels);
+	static const uint8_t *GetSource(const ImagePipeline::TextureData &upload, const Band &band);
+
+	// Hands this frame's bands to the loader context
+	void Submit(TextureRegistry &registry);
+	void Finish(TextureRegistry &registry, const std::shared_ptr<Transfer> &transfer, bool succeeded);
+
+	std::deque<Job> jobs;
+
+	LoaderContext *loader = nullptr;
+
+#if defined(SNOBASTE_GL)
+	struct Buffer {
+		GLuint buffer = 0;
+		GLsync fence = nullptr;
+	};
+
+	// Whether the GPU is done reading the next buffer in the ring
+	bool IsFree();
+	// Maps the next buffer for writing and leaves it bound
+	uint8_t *Map(std::size_t size);
+	void Fence();
+
+	std::array<Buffer, RingSize> ring;
+	std::size_t next = 0;
+#endif
+
+	GLuint placeholder = 0;
+};
\ No newline at end of file
@@ -0,0 +1,84 @@
+#include "Timeline.hpp"
+
+#include <algorithm>
+
+Timeline::Handle Timeline::Start(float from, float to, float duration, float (*curve)(float), Callback done) {
+	auto tween = std::find_if(tweens.begin(), tweens.end(), [](const auto &tween) { return !tween.active; });
+	if (tween == tweens.end()) {
+		logger.WriteDebug("Timeline is full, ending tween straight away");
+		done();
+		return {};
+	}
+
+	tween->from = from;
+	tween->to = to;
+	tween->duration = std::max(duration, Step);
+	tween->passed = 0.0f;
+	tween->curve = curve;
+	tween->done = done;
+	tween->active = true;
+	tween->ended = false;
+
+	return { static_cast<uint32_t>(tween - tweens.begin()), tween->generation };
+}
+
+void Timeline::Stop(Handle &handle) {
+	if (Find(handle)) {
+		auto &tween = tweens[handle.index];
+		tween.active = false;
+		++tween.generation;
+	}
+
+	handle = {};
+}
+
+const Timeline::Tween *Timeline::Find(Handle handle) const {
+	if (handle.index >= Capacity) return nullptr;
+
+	const auto &tween = tweens[handle.index];
+	return tween.active && tween.generation == handle.generation ? &tween : nullptr;
+}
+
+bool Timeline::IsRunning(Handle handle) const {
+	return Find(handle) != nullptr;
+}
+
+bool Timeline::IsEmpty() const {
+	return std::none_of(tweens.begin(), tweens.end(), [](const auto &tween) { return tween.active; });
+}
+
+std::optional<float> Timeline::Value(Handle handle) const {
+	auto tween = Find(handle);
+	if (!tween) return std::nullopt;
+
+	auto progress = std::clamp((tween->passed + accumulator) / tween->duration, 0.0f, 1.0f);
+	return tween->from + tween->curve(progress) * (tween->to - tween->from);
+}
+
+void Timeline::Update(float deltaTime) {
+	accumulator += std::clamp(deltaTime, 0.0f, MaxFrame);
+
+	auto steps = static_cast<int>(accumulator / Step);
+	if (steps == 0) return;
+
+	auto step = steps * Step;
+	accumulator -= step;
+
+	for (auto &tween : tweens) {
+		if (!tween.active) continue;
+
+		tween.passed += step;
+		tween.ended = tween.passed >= tween.duration;
+	}
+
+	// Callbacks may start or stop tweens, so each is
+	// freed before its callback runs
+	for (auto &tween : tweens) {
+		if (!tween.active || !tween.ended) continue;
+
+		auto done = tween.done;
+		tween.active = false;
+		++tween.generation;
+		done();
+	}
+}
\ No newline at end of file
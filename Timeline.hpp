@@ -0,0 +1,99 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <new>
+#include <optional>
+#include <type_traits>
+
+#include "Filesystem/FileRepository.hpp"
+
+#include "Ease.hpp"
+
+using namespace SnobasteCPP;
+
+// Owns every running tween in one fixed pool and advances them all at
+// once, in fixed steps, from the frame time. A long frame is cut short
+// so an animation slows for a moment rather than jumping ahead, and a
+// tween never goes past its end value.
+class Timeline : public LoggableClass {
+public:
+	// Tweens that can run at once
+	static constexpr std::size_t Capacity = 16;
+
+	static constexpr float Step = 1.0f / 240.0f;
+	// Frame time beyond this is dropped
+	static constexpr float MaxFrame = 1.0f / 15.0f;
+
+	// Refers to a tween for as long as it runs, after which
+	// it's stale and treated like an empty one
+	struct Handle {
+		uint32_t index = Capacity;
+		uint32_t generation = 0;
+	};
+
+	// Run once a tween reaches its end. Held inline, so the
+	// captures have to be small and trivially copyable.
+	class Callback {
+	public:
+		Callback() = default;
+
+		template <typename F>
+		Callback(F f) {
+			static_assert(sizeof(F) <= sizeof(storage) && std::is_trivially_copyable_v<F>, "Callback captures too much");
+			new (storage) F(f);
+			invoke = [](void *f) { (*static_cast<F *>(f))(); };
+		}
+
+		void operator()() { if (invoke) invoke(storage); }
+
+	private:
+		alignas(void *) unsigned char storage[sizeof(void *) * 2];
+		void (*invoke)(void *) = nullptr;
+	};
+
+	// Tweens from from to to over duration seconds along Curve,
+	// then calls done. If the pool is full it ends straight away.
+	template <typename Curve = Ease::InCubic>
+	Handle Start(float from, float to, float duration, Callback done = {}) {
+		return Start(from, to, duration, &Curve::Apply, done);
+	}
+
+	// Drops handle's tween without running its callback
+	void Stop(Handle &handle);
+
+	bool IsRunning(Handle handle) const;
+	// Whether no tween is running at all
+	bool IsEmpty() const;
+
+	// The tween's current value, or nothing once it has ended
+	std::optional<float> Value(Handle handle) const;
+
+	// Advances every tween by deltaTime, then runs the callbacks
+	// of those that ended, in pool order
+	void Update(float deltaTime);
+
+private:
+	struct Tween {
+		float from = 0.0f;
+		float to = 0.0f;
+		float duration = 0.0f;
+		float passed = 0.0f;
+		float (*curve)(float) = nullptr;
+		Callback done;
+
+		uint32_t generation = 0;
+		bool active = false;
+		bool ended = false;
+	};
+
+	Handle Start(float from, float to, float duration, float (*curve)(float), Callback done);
+
+	const Tween *Find(Handle handle) const;
+
+	std::array<Tween, Capacity> tweens;
+
+	// Time not yet stepped through, used to place
+	// values between steps
+	float accumulator = 0.0f;
+};
\ No newline at end of file
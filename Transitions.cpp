@@ -0,0 +1,214 @@
+#include "Transitions.hpp"
+
+#include <algorithm>
+#include <string>
+
+namespace {
+	const char *VertexSource = R"(#version 330 core
+// Position, then texture coordinates
+layout(location = 0) in vec4 vertex;
+
+uniform mat4 projection;
+uniform mat4 modelview;
+
+// The quad's bounds, x0 y0 x1 y1
+uniform vec4 rect;
+
+out vec2 texCoord;
+out vec2 local;
+
+void main() {
+	texCoord = vertex.zw;
+	local = (vertex.xy - rect.xy) / (rect.zw - rect.xy);
+	gl_Position = projection * modelview * vec4(vertex.xy, 0.0, 1.0);
+}
+)";
+
+	// Each effect defines Coverage, how much of the pixel at local,
+	// 0 to 1 across the quad, shows at progress
+	const char *FragmentHeader = R"(#version 330 core
+in vec2 texCoord;
+in vec2 local;
+
+uniform sampler2D image;
+uniform vec4 rect;
+uniform vec4 tint;
+uniform float progress;
+
+out vec4 fragColor;
+
+vec2 Size() {
+	return abs(rect.zw - rect.xy);
+}
+)";
+
+	const char *FragmentMain = R"(
+void main() {
+	fragColor = texture(image, texCoord) * tint;
+	fragColor.a *= Coverage();
+}
+)";
+
+	// Indexed by Transitions::Effect
+	const char *Effects[] = {
+		// Reaches the corners at 1, with an edge a pixel wide
+		R"(
+float Coverage() {
+	vec2 size = Size();
+	float away = length((local - 0.5) * size);
+	return clamp(progress * length(size) / 2.0 - away + 0.5, 0.0, 1.0);
+}
+)",
+		// Blocks of 4 pixels, each showing at its own point
+		R"(
+float Coverage() {
+	vec2 block = floor(local * Size() / 4.0);
+	float threshold = fract(sin(dot(block, vec2(12.9898, 78.233))) * 43758.5453);
+	return progress >= 1.0 || threshold < progress ? 1.0 : 0.0;
+}
+)",
+		R"(
+float Coverage() {
+	return progress;
+}
+)",
+		// An edge a few pixels wide, off the quad at 0 and 1
+		R"(
+float Coverage() {
+	float edge = 4.0 / max(Size().x, 1.0);
+	return clamp((progress * (1.0 + edge) - local.x) / edge, 0.0, 1.0);
+}
+)"
+	};
+
+	const unsigned short QuadIndices[6] = { 0, 1, 2, 0, 2, 3 };
+}
+
+void Transitions::Init() {
+	static_assert(sizeof(Effects) / sizeof(*Effects) == static_cast<std::size_t>(Effect::Count));
+
+#if defined(SNOBASTE_GL)
+	const auto compile = [&](GLenum type, const std::string &source) {
+		auto shader = glCreateShader(type);
+		auto text = source.c_str();
+		glShaderSource(shader, 1, &text, nullptr);
+		glCompileShader(shader);
+
+		GLint status = GL_FALSE;
+		glGetShaderiv(shader, GL_COMPILE_STATUS, &status);
+		if (status != GL_TRUE) {
+			char log[1024] = {};
+			glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+			logger.WriteDebug("Transition shader failed to compile: ", log);
+		}
+
+		return shader;
+	};
+
+	auto vertexShader = compile(GL_VERTEX_SHADER, VertexSource);
+
+	for (std::size_t i = 0; i < programs.size(); ++i) {
+		auto fragmentShader = compile(GL_FRAGMENT_SHADER, std::string(FragmentHeader) + Effects[i] + FragmentMain);
+
+		auto program = glCreateProgram();
+		glAttachShader(program, vertexShader);
+		glAttachShader(program, fragmentShader);
+		glLinkProgram(program);
+		glDeleteShader(fragmentShader);
+
+		GLint status = GL_FALSE;
+		glGetProgramiv(program, GL_LINK_STATUS, &status);
+		if (status != GL_TRUE) {
+			logger.WriteDebug("Transition shader failed to link, drawing transitions as fades");
+			glDeleteProgram(program);
+			glDeleteShader(vertexShader);
+			Cleanup();
+			return;
+		}
+
+		auto &location = locations[i];
+		location.projection = glGetUniformLocation(program, "projection");
+		location.modelview = glGetUniformLocation(program, "modelview");
+		location.rect = glGetUniformLocation(program, "rect");
+		location.tint = glGetUniformLocation(program, "tint");
+		location.progress = glGetUniformLocation(program, "progress");
+
+		glUseProgram(program);
+		glUniform1i(glGetUniformLocation(program, "image"), 0);
+		glUseProgram(0);
+
+		programs[i] = program;
+	}
+	glDeleteShader(vertexShader);
+
+	glGenVertexArrays(1, &vertexArray);
+	glGenBuffers(2, buffers);
+	glBindVertexArray(vertexArray);
+	glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 16, nullptr, GL_STREAM_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffers[1]);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(QuadIndices), QuadIndices, GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 0, nullptr);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+#endif
+}
+
+void Transitions::Cleanup() {
+#if defined(SNOBASTE_GL)
+	for (auto program : programs) {
+		if (program)
+			glDeleteProgram(program);
+	}
+
+	if (vertexArray) {
+		glDeleteVertexArrays(1, &vertexArray);
+		glDeleteBuffers(2, buffers);
+	}
+#endif
+
+	programs = {};
+	vertexArray = buffers[0] = buffers[1] = 0;
+}
+
+void Transitions::Draw(const SpriteBatch &sprites, Effect effect, GLuint texture, const float *vertices, const float *texCoords, float progress) {
+#if defined(SNOBASTE_GL)
+	auto index = static_cast<std::size_t>(effect);
+	if (!texture || index >= programs.size() || !programs[index]) return;
+
+	const auto &location = locations[index];
+
+	float quad[16];
+	for (int i = 0; i < 4; ++i) {
+		quad[i * 4] = vertices[i * 2];
+		quad[i * 4 + 1] = vertices[i * 2 + 1];
+		quad[i * 4 + 2] = texCoords[i * 2];
+		quad[i * 4 + 3] = texCoords[i * 2 + 1];
+	}
+
+	const auto [left, right] = std::minmax({ vertices[0], vertices[2], vertices[4], vertices[6] });
+	const auto [top, bottom] = std::minmax({ vertices[1], vertices[3], vertices[5], vertices[7] });
+
+	glUseProgram(programs[index]);
+	glUniformMatrix4fv(location.projection, 1, GL_FALSE, sprites.GetProjection());
+	glUniformMatrix4fv(location.modelview, 1, GL_FALSE, sprites.GetModelview());
+	glUniform4f(location.rect, left, top, right, bottom);
+	glUniform4fv(location.tint, 1, sprites.GetColor());
+	glUniform1f(location.progress, std::clamp(progress, 0.0f, 1.0f));
+
+	glBindBuffer(GL_ARRAY_BUFFER, buffers[0]);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(quad), quad);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glBindVertexArray(vertexArray);
+	glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_SHORT, nullptr);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glUseProgram(0);
+#endif
+}
\ No newline at end of file
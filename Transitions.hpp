@@ -0,0 +1,54 @@
+#pragma once
+
+#include <array>
+
+#include "glad/glad.h"
+
+#include "Filesystem/FileRepository.hpp"
+
+#include "SpriteBatch.hpp"
+
+using namespace SnobasteCPP;
+
+// Effects for bringing a textured quad in, each a fragment shader
+// driven by a single progress value, from 0 for nothing shown to 1
+// for the whole quad. The quad is placed and tinted by the sprite
+// batch's transform and colour, like a sprite.
+class Transitions : public LoggableClass {
+public:
+	enum class Effect {
+		// A circle growing from the centre
+		Reveal,
+		// Scattered blocks of pixels
+		Dissolve,
+		Fade,
+		// Left to right
+		Wipe,
+		Count
+	};
+
+	void Init();
+	void Cleanup();
+
+	// False if the shaders couldn't be built
+	bool IsAvailable() const { return programs[0] != 0; }
+
+	// Draws a quad given as four corners and their texture
+	// coordinates, in the order the renderer's index buffer uses
+	void Draw(const SpriteBatch &sprites, Effect effect, GLuint texture, const float *vertices, const float *texCoords, float progress);
+
+private:
+	struct Locations {
+		GLint projection = -1;
+		GLint modelview = -1;
+		GLint rect = -1;
+		GLint tint = -1;
+		GLint progress = -1;
+	};
+
+	std::array<GLuint, static_cast<std::size_t>(Effect::Count)> programs = {};
+	std::array<Locations, static_cast<std::size_t>(Effect::Count)> locations = {};
+
+	GLuint vertexArray = 0;
+	GLuint buffers[2] = { 0, 0 };
+};
\ No newline at end of file
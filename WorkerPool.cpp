@@ -0,0 +1,94 @@
+#include "WorkerPool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+WorkerPool::WorkerPool(std::size_t threadCount) {
+	if (threadCount == 0)
+		threadCount = std::max(1u, std::thread::hardware_concurrency()) - 1;
+
+	threadCount = std::max<std::size_t>(threadCount, 1);
+	for (std::size_t i = 0; i < threadCount; ++i)
+		threads.emplace_back(&WorkerPool::Work, this);
+}
+
+WorkerPool::~WorkerPool() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	condition.notify_all();
+
+	for (auto &thread : threads)
+		thread.join();
+}
+
+void WorkerPool::Submit(std::function<void()> job) {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobs.emplace_back(std::move(job));
+	}
+	condition.notify_one();
+}
+
+void WorkerPool::ParallelFor(std::size_t count, const std::function<void(std::size_t)> &f) {
+	if (count == 0) return;
+
+	struct State {
+		std::atomic<std::size_t> next = 0;
+		std::size_t done = 0;
+		std::mutex mutex;
+		std::condition_variable condition;
+	};
+	auto state = std::make_shared<State>();
+
+	// Helpers that start after everything is claimed
+	// return without touching f
+	const auto run = [state, count, &f] {
+		std::size_t finished = 0;
+		for (auto i = state->next++; i < count; i = state->next++) {
+			f(i);
+			++finished;
+		}
+
+		if (finished) {
+			std::lock_guard<std::mutex> lock(state->mutex);
+			state->done += finished;
+			if (state->done == count)
+				state->condition.notify_all();
+		}
+	};
+
+	auto helpers = std::min(count - 1, threads.size());
+	for (std::size_t i = 0; i < helpers; ++i)
+		Submit(run);
+
+	run();
+
+	std::unique_lock<std::mutex> lock(state->mutex);
+	state->condition.wait(lock, [&] { return state->done == count; });
+}
+
+WorkerPool &WorkerPool::Shared() {
+	static WorkerPool pool;
+	return pool;
+}
+
+void WorkerPool::Work() {
+	while (true) {
+		std::function<void()> job;
+
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			condition.wait(lock, [&] { return stopping || !jobs.empty(); });
+
+			if (stopping && jobs.empty()) return;
+
+			job = std::move(jobs.front());
+			jobs.pop_front();
+		}
+
+		job();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed-size pool of worker threads for CPU-bound loading work
+class WorkerPool {
+public:
+	// Zero threads means one less than the core count
+	explicit WorkerPool(std::size_t threadCount = 0);
+	~WorkerPool();
+
+	WorkerPool(const WorkerPool &) = delete;
+	WorkerPool &operator=(const WorkerPool &) = delete;
+
+	void Submit(std::function<void()> job);
+
+	// Runs f(i) for every i in [0, count) on the pool and returns
+	// once all of them have finished. The calling thread works too,
+	// so this is safe to call from inside a pool job.
+	void ParallelFor(std::size_t count, const std::function<void(std::size_t)> &f);
+
+	std::size_t GetThreadCount() const { return threads.size(); }
+
+	// Pool shared by all loaders
+	static WorkerPool &Shared();
+
+private:
+	void Work();
+
+	std::vector<std::thread> threads;
+	std::deque<std::function<void()>> jobs;
+
+	std::mutex mutex;
+	std::condition_variable condition;
+	bool stopping = false;
+};
\ No newline at end of file
@@ -12,6 +12,7 @@
 
 #include "Engine.hpp"
 #include "Book.hpp"
+#include "FileWatcher.hpp"
 
 using namespace SnobasteCPP;
 
@@ -22,10 +23,33 @@ void scroll(GLFWwindow *window, double x, double y) {
 	//z -= y;
 }
 
+void cursor_position_callback(GLFWwindow *window, double x, double y) {
+	auto engine = static_cast<Engine *>(glfwGetWindowUserPointer(window));
+
+	// Only the menu reacts to hovering
+	if (engine->GetState() != Engine::State::Book)
+		engine->GetPacer()->Invalidate();
+}
+
+void window_refresh_callback(GLFWwindow *window) {
+	auto engine = static_cast<Engine *>(glfwGetWindowUserPointer(window));
+
+	engine->GetPacer()->Invalidate();
+}
+
 void window_focus_callback(GLFWwindow *window, int focused) {
 	auto engine = static_cast<Engine *>(glfwGetWindowUserPointer(window));
 
 	engine->GetManager()->SetFocued(focused == GLFW_TRUE);
+	engine->GetPacer()->SetFocused(focused == GLFW_TRUE);
+	engine->GetPacer()->Invalidate();
+}
+
+void window_iconify_callback(GLFWwindow *window, int iconified) {
+	auto engine = static_cast<Engine *>(glfwGetWindowUserPointer(window));
+
+	engine->GetPacer()->SetIconified(iconified == GLFW_TRUE);
+	engine->GetPacer()->Invalidate();
 }
 
 void framebuffer_size_callback(GLFWwindow *window, int width, int height) {
@@ -35,10 +59,13 @@ void framebuffer_size_callback(GLFWwindow *window, int width, int height) {
 	auto engine = static_cast<Engine *>(glfwGetWindowUserPointer(window));
 
 	engine->GetRenderer()->Resize(width, height);
+	engine->GetPacer()->Invalidate();
 }
 
 void key_callback(GLFWwindow *window, int key, int scancode, int action, int mods) {
 	auto engine = static_cast<Engine *>(glfwGetWindowUserPointer(window));
+	engine->GetPacer()->Invalidate();
+
 	if (action == GLFW_PRESS) {
 		switch (key) {
 		case GLFW_KEY_SPACE:
@@ -64,6 +91,7 @@ void mouse_button_callback(GLFWwindow *window, int button, int action, int mods)
 	auto engine = static_cast<Engine *>(glfwGetWindowUserPointer(window));
 
 	engine->GetManager()->OnMouseClicked(button, action, mods);
+	engine->GetPacer()->Invalidate();
 }
 
 int main(int argc, char *argv[]) {
@@ -77,6 +105,9 @@ int main(int argc, char *argv[]) {
 	glfwWindowHint(GLFW_SAMPLES, 1);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
 	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	// Sprites go through a core shader, but fonts, the loading
+	// indicator, checkboxes and the menu's plain quads are still
+	// drawn with the fixed function pipeline
 	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_COMPAT_PROFILE);
 
 	GLFWwindow *window = glfwCreateWindow(WindowWidth, WindowHeight, "CHAnniversary", nullptr, nullptr);
@@ -118,7 +149,10 @@ int main(int argc, char *argv[]) {
 	//SnobasteCPP::ParticleSystem system(*engine.renderer);
 
 	glfwSetScrollCallback(window, scroll);
+	glfwSetCursorPosCallback(window, cursor_position_callback);
+	glfwSetWindowRefreshCallback(window, window_refresh_callback);
 	glfwSetWindowFocusCallback(window, window_focus_callback);
+	glfwSetWindowIconifyCallback(window, window_iconify_callback);
 	glfwSetKeyCallback(window, key_callback);
 	glfwSetMouseButtonCallback(window, mouse_button_callback);
 	glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
@@ -158,38 +192,48 @@ int main(int argc, char *argv[]) {
 	auto resolution = StringUtils::Split(resolutionSetting.settingValues[resolutionSetting.value], "x");
 	framebuffer_size_callback(window, std::stoi(resolution[0]), std::stoi(resolution[1]));
 
-#ifdef _WIN32
-	// Turn on vertical screen sync under Windows.
-	// (I.e. it uses the WGL_EXT_swap_control extension)
-	typedef BOOL(WINAPI *PFNWGLSWAPINTERVALEXTPROC)(int interval);
-	PFNWGLSWAPINTERVALEXTPROC wglSwapIntervalEXT = NULL;
-	wglSwapIntervalEXT = (PFNWGLSWAPINTERVALEXTPROC)wglGetProcAddress("wglSwapIntervalEXT");
-	if (wglSwapIntervalEXT)
-		wglSwapIntervalEXT(1);
-#endif
+	// Pick up edits to books and images while running.
+	// Cache is ours, so don't react to our own writes.
+	FileWatcher watcher(FileRepository::registry->GetResourceDirectory(), { "Cache" });
 
 	double lastTime = glfwGetTime();
 	while (!glfwWindowShouldClose(window)) {
-		double currentTime = glfwGetTime();
-		engine->GetManager()->SetDeltaTime(currentTime - lastTime);
 		engine->GetManager()->ProcessInput(window);
 
-		// Clear background
-		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT);
+		if (auto changed = watcher.Poll(); !changed.empty()) {
+			engine->OnFilesChanged(changed);
+			engine->GetPacer()->Invalidate();
+		}
 
-		//glBindTexture(GL_TEXTURE_2D, image);
-		auto load = engine->GetRenderer()->Render();
-		//system.OnLoop();
-		//system.OnRender(0);
+		// Otherwise the last frame still stands
+		if (engine->GetPacer()->TakeFrame()) {
+			// Time since the last frame drawn, not the last wake,
+			// so the writer catches up on time spent idle
+			double currentTime = glfwGetTime();
+			engine->GetManager()->SetDeltaTime(currentTime - lastTime);
 
-		glfwSwapBuffers(window);
+			// Clear background
+			glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+			glClear(GL_COLOR_BUFFER_BIT);
 
-		// If we had to load something during our
-		// render, toss out this frametime
-		lastTime = load ? glfwGetTime() : currentTime;
+			//glBindTexture(GL_TEXTURE_2D, image);
+			bool load = engine->GetRenderer()->Render();
+			//system.OnLoop();
+			//system.OnRender(0);
+
+			glfwSwapBuffers(window);
+
+			// Vertical sync is on everywhere, this
+			// holds frames to the cap on top of it
+			engine->GetPacer()->Wait();
+
+			// If we had to load something during our
+			// render, toss out this frametime
+			lastTime = load ? glfwGetTime() : currentTime;
+		}
 
-		glfwPollEvents();
+		// Blocks while nothing needs drawing
+		engine->GetPacer()->WaitEvents();
 	}
 
 	// Kill engine before terminating GL